@@ -0,0 +1,314 @@
+/***************************************************************
+  Student Name: Trevor Mee
+  File Name: bench_backends.cpp
+  Project 2
+
+  @brief Benchmark and self-check of the register backend against
+         the stack RPN. Generates a runnable program of each shape,
+         compiles it, and compares the instruction counts of the two
+         forms, then times both VMs running it to the end. Each run is
+         repeated after a warm-up run and reported as the median, and
+         the variables both VMs end with must agree.
+
+         usage: bench_backends [--shape=NAME|all] [--size=MB] [--reps=N]
+                               [--seed=N] [--registers=N] [-O0|-O1]
+                               [--check FILE...]
+         --check runs each file on both VMs at -O0 and -O1, with one
+         register and with --registers, and compares the results
+***************************************************************/
+
+#include "generator.hpp"
+#include "parser.hpp"
+#include "register_code.hpp"
+#include "register_vm.hpp"
+#include "source_file.hpp"
+#include "vm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// --check stops programs that loop after this many instructions
+static constexpr uint64_t CHECK_LIMIT = 1000000;
+
+
+/*
+    @brief runs some work repeatedly and gets the median run time
+    @param(s) reps how many timed runs, after one untimed warm-up run
+              work the work to time
+    @return the median, in seconds
+*/
+template <typename Work>
+static double medianTime(int reps, Work work)
+{
+    work();
+    std::vector<double> seconds;
+    for (int r = 0; r < reps; r++) {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(seconds.begin(), seconds.end());
+    return seconds[seconds.size() / 2];
+}
+
+
+/*
+    @brief compiles a source into RPN, as proj2 would
+    @param(s) name the program's name in messages
+              source the program, ending in the EOI sentinel
+              optimize the -O level
+              program receives the RPN
+    @return true if the program is legal
+*/
+static bool compile(const std::string& name, const std::string& source, int optimize, IRProgram& program)
+{
+    std::ostringstream messages;
+    Scanner scanner(source.data(), source.size());
+    scanner.setOutput(messages);
+    Parser parser(scanner, messages, messages);
+    OutputOptions output;
+    output.text = false;
+    output.optimize = optimize;
+    parser.setOutputOptions(output);
+    if (!parser.parse(name)) {
+        return false;
+    }
+    program = parser.getIR();
+    return true;
+}
+
+
+/*
+    @brief counts the RPN instructions that execute, leaving out labels
+    @param program the RPN
+    @return the instruction count
+*/
+static size_t stackInstructions(const IRProgram& program)
+{
+    return std::count_if(program.code.begin(), program.code.end(), [](const Instr& instr) {
+        return instr.op != Op::LABEL;
+    });
+}
+
+
+/*
+    @brief checks that two loaded VMs ended a run in the same state
+    @param(s) stack the stack VM after its run
+              stackOk whether its run completed
+              registers the register VM after its run
+              registerOk whether its run completed
+    @return true if both completed or both failed, with the same variables
+*/
+static bool sameResults(const VM& stack, bool stackOk, const RegisterVM& registers, bool registerOk)
+{
+    if (stackOk != registerOk || stack.variableCount() != registers.variableCount()) {
+        return false;
+    }
+    for (size_t slot = 0; slot < stack.variableCount(); slot++) {
+        if (stack.variable(slot) != registers.variable(slot)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/*
+    @brief runs one program on both VMs and compares the outcomes;
+           a run stopped by the instruction limit is not compared, as
+           the two count different instructions
+    @param(s) name the program's name, for the report
+              program the RPN
+              registers size of the register file
+    @return 1 if the results differ, 0 otherwise
+*/
+static size_t checkProgram(const std::string& name, const IRProgram& program, unsigned registers)
+{
+    VM stack;
+    RegisterVM registerVM;
+    RegisterProgram registerCode;
+    std::string stackError;
+    std::string registerError;
+    bool loaded = stack.load(program, stackError);
+    bool generated = generateRegisterCode(program, registers, registerCode, registerError)
+                     && registerVM.load(registerCode, registerError);
+    if (loaded != generated) {
+        std::cout << "MISMATCH " << name << " (" << registers << " registers): load: " << stackError << " / "
+                  << registerError << std::endl;
+        return 1;
+    }
+    if (!loaded) {
+        return 0;
+    }
+
+    bool stackOk = stack.run(stackError, CHECK_LIMIT);
+    bool registerOk = registerVM.run(registerError, CHECK_LIMIT);
+    bool limited = stackError.rfind("Instruction limit", 0) == 0 || registerError.rfind("Instruction limit", 0) == 0;
+    if (!limited && !sameResults(stack, stackOk, registerVM, registerOk)) {
+        std::cout << "MISMATCH " << name << " (" << registers << " registers): " << stackError << " / "
+                  << registerError << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+    @brief compiles a file and checks it on both VMs at -O0 and -O1
+    @param(s) path the source file
+              registers size of the larger register file to try
+    @return the number of mismatches
+*/
+static size_t checkFile(const std::string& path, unsigned registers)
+{
+    SourceFile file;
+    std::string errorMsg;
+    if (!file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+    std::string source(file.data(), file.size());      // ends in the EOI sentinel
+
+    size_t mismatches = 0;
+    for (int optimize = 0; optimize <= 1; optimize++) {
+        IRProgram program;
+        if (!compile(path, source, optimize, program)) {
+            continue;
+        }
+        std::string name = path + " -O" + std::to_string(optimize);
+        mismatches += checkProgram(name, program, 1);
+        if (registers != 1) {
+            mismatches += checkProgram(name, program, registers);
+        }
+    }
+    return mismatches;
+}
+
+
+/*
+    @brief compares both backends on one program
+    @param(s) shape the program's shape, for the heading
+              source the program, ending in the EOI sentinel
+              optimize the -O level
+              registers size of the register file
+              reps timed repetitions per VM
+    @return false if the program did not compile or run, or the VMs
+            disagree
+*/
+static bool benchmark(ProgramGenerator::Shape shape, const std::string& source, int optimize, unsigned registers,
+                      int reps)
+{
+    const char* name = ProgramGenerator::shapeName(shape);
+    std::cout << name << ": " << source.size() - 1 << " bytes" << std::endl;
+
+    IRProgram program;
+    RegisterProgram registerCode;
+    VM stack;
+    RegisterVM registerVM;
+    std::string errorMsg;
+    if (!compile(name, source, optimize, program)
+        || !generateRegisterCode(program, registers, registerCode, errorMsg)
+        || !stack.load(program, errorMsg) || !registerVM.load(registerCode, errorMsg)) {
+        std::cout << "  FAILED to compile: " << errorMsg << std::endl;
+        return false;
+    }
+
+    size_t stackCount = stackInstructions(program);
+    size_t registerCount = registerCode.instructionCount();
+    std::cout << std::fixed << std::setprecision(1) << "  code       stack " << std::setw(10) << stackCount
+              << "   register " << std::setw(10) << registerCount << "  (" << std::setw(5)
+              << 100.0 * registerCount / std::max<size_t>(stackCount, 1) << "%), " << registerCode.usedRegisters
+              << " registers, " << registerCode.spillSlots << " spill slots for " << registerCode.spilled << " of "
+              << registerCode.values << " values" << std::endl;
+
+    bool stackOk = true;
+    bool registerOk = true;
+    double stackTime = medianTime(reps, [&]() {
+        stackOk = stack.run(errorMsg) && stackOk;
+    });
+    double registerTime = medianTime(reps, [&]() {
+        registerOk = registerVM.run(errorMsg) && registerOk;
+    });
+    if (!stackOk || !registerOk) {
+        std::cout << "  FAILED to run: " << errorMsg << std::endl;
+        return false;
+    }
+
+    uint64_t stackExecuted = stack.getStats().instructions;
+    uint64_t registerExecuted = registerVM.getStats().instructions;
+    std::cout << std::setprecision(3) << "  run        stack " << std::setw(10) << stackExecuted << "   register "
+              << std::setw(10) << registerExecuted << "  executed;  " << stackTime * 1e3 << " ms vs "
+              << registerTime * 1e3 << " ms, " << std::setprecision(2)
+              << stackTime / std::max(registerTime, 1e-9) << "x" << std::defaultfloat << std::endl;
+
+    if (!sameResults(stack, true, registerVM, true)) {
+        std::cout << "  MISMATCH: the VMs end with different variables" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    ProgramGenerator::Options options;
+    options.bytes = 4 << 20;
+    options.runnable = true;
+    int reps = 9;
+    int optimize = 0;
+    unsigned registers = RegisterProgram::DEFAULT_REGISTERS;
+    bool allShapes = true;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--shape=", 0) == 0) {
+            std::string name = arg.substr(8);
+            allShapes = name == "all";
+            if (!allShapes && !ProgramGenerator::parseShape(name, options.shape)) {
+                std::cerr << "Error: Unknown shape " << name << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--size=", 0) == 0) {
+            options.bytes = static_cast<size_t>(std::atof(arg.c_str() + 7) * (1 << 20));
+        } else if (arg.rfind("--reps=", 0) == 0) {
+            reps = std::max(1, std::atoi(arg.c_str() + 7));
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            options.seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else if (arg.rfind("--registers=", 0) == 0) {
+            registers = static_cast<unsigned>(std::max(1, std::atoi(arg.c_str() + 12)));
+        } else if (arg == "-O0" || arg == "-O1") {
+            optimize = arg[2] - '0';
+        } else if (arg == "--check") {
+            size_t mismatches = 0;
+            for (i++; i < argc; i++) {
+                mismatches += checkFile(argv[i], registers);
+            }
+            std::cout << "register VM against stack VM: " << mismatches << " mismatches" << std::endl;
+            return mismatches == 0 ? 0 : 1;
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--shape=NAME|all] [--size=MB] [--reps=N] [--seed=N] [--registers=N] [-O0|-O1] [--check FILE...]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Each VM: one warm-up run, then the median of " << reps << " runs, with " << registers
+              << " registers at -O" << optimize << std::endl;
+    bool ok = true;
+    for (size_t i = 0; i < static_cast<size_t>(ProgramGenerator::Shape::COUNT); i++) {
+        ProgramGenerator::Shape shape = static_cast<ProgramGenerator::Shape>(i);
+        if (!allShapes && shape != options.shape) {
+            continue;
+        }
+        options.shape = shape;
+        std::string source = ProgramGenerator(options).generate();
+        source.push_back(Scanner::EOI);
+        ok = benchmark(shape, source, optimize, registers, reps) && ok;
+    }
+    return ok ? 0 : 1;
+}
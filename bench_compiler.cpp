@@ -0,0 +1,473 @@
+/***************************************************************
+  Student Name: Trevor Mee
+  File Name: bench_compiler.cpp
+  Project 2
+
+  @brief Microbenchmarks of the compiler's phases over generated
+         programs: Scanner::nextToken alone, Parser::parse (scanning
+         included), the same split by --pretokenize into
+         TokenBuffer::lex and parsing the buffer, lexing and parsing on
+         --threads threads, and the RPN formatting that printRPN does. Each is
+         repeated after a warm-up run and reported as the median rate
+         with the spread of the repetitions.
+
+         usage: bench_compiler [--shape=NAME|all] [--size=MB] [--reps=N]
+                               [--seed=N] [--depth=N] [--terms=N] [--threads=N]
+                               [--emit=PATH] [--check-lex FILE...]
+                               [--check-parse FILE...] [--check-stream FILE...]
+         --emit writes the generated program instead of benchmarking
+         --check-lex compares the parallel lex of each file, cut into
+         2 to MAX_CHECK_CHUNKS chunks, with the serial lex
+         --check-parse does the same for the parallel parse, comparing
+         legality, messages and RPN text
+         --check-stream compiles each file streamed through windows of
+         1 to MAX_CHECK_CHUNKS bytes and compares messages, with their
+         line and column, and RPN text with the in-memory compile
+***************************************************************/
+
+#include "generator.hpp"
+#include "parser.hpp"
+#include "rpn_writer.hpp"
+#include "source_file.hpp"
+#include "token_buffer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+// --check-lex, --check-parse and --check-stream try every chunk count,
+// or chunk size in bytes, up to this
+static constexpr unsigned MAX_CHECK_CHUNKS = 32;
+
+// repetition statistics of one phase, in seconds
+struct Timing {
+    double median = 0;
+    double min = 0;
+    double spread = 0;          // standard deviation over mean
+};
+
+
+/*
+    @brief runs a phase repeatedly and summarizes the run times
+    @param(s) reps how many timed runs, after one untimed warm-up run
+              phase the work to time
+    @return the statistics
+*/
+template <typename Phase>
+static Timing timePhase(int reps, Phase phase)
+{
+    phase();
+    std::vector<double> seconds;
+    for (int r = 0; r < reps; r++) {
+        auto start = std::chrono::steady_clock::now();
+        phase();
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(seconds.begin(), seconds.end());
+
+    Timing timing;
+    timing.median = seconds[seconds.size() / 2];
+    timing.min = seconds.front();
+    double mean = 0;
+    for (double s : seconds) {
+        mean += s;
+    }
+    mean /= seconds.size();
+    double variance = 0;
+    for (double s : seconds) {
+        variance += (s - mean) * (s - mean);
+    }
+    timing.spread = mean > 0 ? std::sqrt(variance / seconds.size()) / mean : 0;
+    return timing;
+}
+
+
+/*
+    @brief prints one phase's results
+    @param(s) name the phase
+              timing its statistics
+              bytes input (or output) bytes per run
+              items tokens or instructions per run
+              unit what items are
+    @return N/A
+*/
+static void report(const char* name, const Timing& timing, size_t bytes, size_t items, const char* unit)
+{
+    std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(9) << bytes / timing.median / 1e6 << " MB/s"
+              << std::setprecision(2) << std::setw(10) << items / timing.median / 1e6 << " M" << unit << "/s"
+              << "   median " << std::setprecision(3) << timing.median * 1e3 << " ms, min "
+              << timing.min * 1e3 << " ms, +/- " << std::setprecision(1) << timing.spread * 100 << "%"
+              << std::defaultfloat << std::endl;
+}
+
+
+/*
+    @brief benchmarks every phase on one program
+    @param(s) shape the program's shape, for the heading
+              source the program, ending in the EOI sentinel
+              reps timed repetitions per phase
+              threads threads for the parallel lex
+    @return false if the program did not compile, or the parallel lex
+            or parse differs from the serial one
+*/
+static bool benchmark(ProgramGenerator::Shape shape, const std::string& source, int reps, unsigned threads)
+{
+    size_t bytes = source.size() - 1;
+    size_t lines = std::count(source.begin(), source.end(), '\n');
+    std::cout << ProgramGenerator::shapeName(shape) << ": " << bytes << " bytes, " << lines << " lines" << std::endl;
+
+    size_t tokens = 0;
+    Timing scan = timePhase(reps, [&]() {
+        Scanner scanner(source.data(), source.size());
+        tokens = 0;
+        while (scanner.nextToken().type != Scanner::eoIToken) {
+            tokens++;
+        }
+    });
+    report("nextToken", scan, bytes, tokens, "tokens");
+
+    // progress messages are discarded
+    std::ostream discard(nullptr);
+    OutputOptions output;
+    output.text = false;
+    Timing parse = timePhase(reps, [&]() {
+        Scanner scanner(source.data(), source.size());
+        scanner.setOutput(discard);
+        Parser parser(scanner, discard, discard);
+        parser.reserveIR(source.size() / 4);
+        parser.setOutputOptions(output);
+        parser.parse("bench");
+    });
+
+    // once more to keep the IR for printRPN
+    Scanner scanner(source.data(), source.size());
+    Parser parser(scanner, discard, discard);
+    parser.setOutputOptions(output);
+    if (!parser.parse("bench")) {
+        std::cerr << "Error: the generated " << ProgramGenerator::shapeName(shape) << " program is illegal" << std::endl;
+        return false;
+    }
+    const IRProgram& program = parser.getIR();
+    report("parse", parse, bytes, program.code.size(), "instr");
+
+    // the same, split by --pretokenize into lexing and parsing the buffer
+    TokenBuffer buffer;
+    Timing lex = timePhase(reps, [&]() {
+        Scanner scanner(source.data(), source.size());
+        buffer.lex(scanner);
+    });
+    report("lex", lex, bytes, buffer.size(), "tokens");
+
+    Scanner lexed(source.data(), source.size());
+    buffer.lex(lexed);
+    Timing parseTokens = timePhase(reps, [&]() {
+        Parser parser(lexed, discard, discard, &buffer);
+        parser.reserveIR(source.size() / 4);
+        parser.setOutputOptions(output);
+        parser.parse("bench");
+    });
+    report("parse-tok", parseTokens, bytes, program.code.size(), "instr");
+
+    TokenBuffer parallel;
+    Timing lexParallel = timePhase(reps, [&]() {
+        Scanner scanner(source.data(), source.size());
+        parallel.lex(scanner, nullptr, threads);
+    });
+    report("lex-par", lexParallel, bytes, parallel.size(), "tokens");
+    if (!parallel.matches(buffer)) {
+        std::cerr << "Error: lexing on " << threads << " threads differs from lexing serially" << std::endl;
+        return false;
+    }
+
+    RPNWriter writer;
+    std::string text;
+    std::string parallelText;
+    Timing parseParallel = timePhase(reps, [&]() {
+        Parser parser(lexed, discard, discard, &buffer);
+        parser.reserveIR(source.size() / 4);
+        parser.setOutputOptions(output);
+        parser.setThreads(threads);
+        parser.parse("bench");
+    });
+    report("parse-par", parseParallel, bytes, program.code.size(), "instr");
+    Parser parallelParser(lexed, discard, discard, &buffer);
+    parallelParser.setOutputOptions(output);
+    parallelParser.setThreads(threads);
+    parallelParser.parse("bench");
+    writer.format(parallelParser.getIR(), parallelText);
+    writer.format(program, text);
+    if (parallelText != text) {
+        std::cerr << "Error: parsing on " << threads << " threads differs from parsing serially" << std::endl;
+        return false;
+    }
+
+    Timing print = timePhase(reps, [&]() {
+        writer.format(program, text);
+    });
+    report("printRPN", print, text.size(), program.code.size(), "instr");
+    return true;
+}
+
+
+/*
+    @brief lexes a file serially and then in parallel, cut into every
+           number of chunks up to MAX_CHECK_CHUNKS, however small
+    @param path the file
+    @return the number of chunkings whose tokens differ, 1 if the file
+            cannot be read
+*/
+static size_t checkLex(const std::string& path)
+{
+    SourceFile file;
+    std::string errorMsg;
+    if (!file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+    Scanner serialScanner(file.data(), file.size());
+    TokenBuffer serial;
+    serial.lex(serialScanner);
+
+    size_t mismatches = 0;
+    for (unsigned chunks = 2; chunks <= MAX_CHECK_CHUNKS; chunks++) {
+        Scanner scanner(file.data(), file.size());
+        TokenBuffer parallel;
+        parallel.lex(scanner, nullptr, chunks, 1);
+        if (!parallel.matches(serial)) {
+            std::cerr << path << ": lexing in " << chunks << " chunks differs from the serial lex" << std::endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+
+/*
+    @brief compiles a pre-lexed file in memory, as proj2 --pretokenize
+           would without writing any files
+    @param(s) file the source
+              threads threads for the statements
+              minPieceTokens the fewest tokens per thread
+              rpn receives the RPN text and bytecode image, which has
+                  the symbol slots, if the program is legal
+    @return every message, and whether the program is legal, at the end
+*/
+static std::string compileTokens(const SourceFile& file, unsigned threads, size_t minPieceTokens, std::string& rpn)
+{
+    std::ostringstream log;
+    Scanner scanner(file.data(), file.size());
+    scanner.setOutput(log);
+    TokenBuffer buffer;
+    buffer.lex(scanner);
+    Parser parser(scanner, log, log, &buffer);
+    OutputOptions output;
+    output.text = false;
+    parser.setOutputOptions(output);
+    parser.setThreads(threads, minPieceTokens);
+    bool ok = parser.parse("check");
+    rpn.clear();
+    if (ok) {
+        std::string image;
+        std::string errorMsg;
+        RPNWriter().format(parser.getIR(), rpn);
+        encodeBytecode(parser.getIR(), image, errorMsg);
+        rpn += image;
+    }
+    log << (ok ? "legal" : "illegal") << std::endl;
+    return log.str();
+}
+
+
+/*
+    @brief compiles a file serially and then with its statements parsed
+           in every number of pieces up to MAX_CHECK_CHUNKS, however
+           small, comparing messages, RPN text and bytecode
+    @param path the file
+    @return the number of piece counts whose results differ, 1 if the
+            file cannot be read
+*/
+static size_t checkParse(const std::string& path)
+{
+    SourceFile file;
+    std::string errorMsg;
+    if (!file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+    std::string serialRPN;
+    std::string serial = compileTokens(file, 1, 1, serialRPN);
+
+    size_t mismatches = 0;
+    for (unsigned pieces = 2; pieces <= MAX_CHECK_CHUNKS; pieces++) {
+        std::string rpn;
+        if (compileTokens(file, pieces, 1, rpn) != serial || rpn != serialRPN) {
+            std::cerr << path << ": parsing in " << pieces << " pieces differs from the serial parse" << std::endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+
+/*
+    @brief compiles a source with the given scanner, as proj2 would
+           without writing any files
+    @param(s) scanner the scanner over the source
+              rpn receives the RPN text if the program is legal
+    @return every message, and whether the program is legal, at the end
+*/
+static std::string compileScanned(Scanner& scanner, std::string& rpn)
+{
+    std::ostringstream log;
+    scanner.setOutput(log);
+    Parser parser(scanner, log, log);
+    OutputOptions output;
+    output.text = false;
+    parser.setOutputOptions(output);
+    bool ok = parser.parse("check");
+    rpn.clear();
+    if (ok) {
+        RPNWriter().format(parser.getIR(), rpn);
+    }
+    log << (ok ? "legal" : "illegal") << std::endl;
+    return log.str();
+}
+
+
+/*
+    @brief compiles a file in memory and then streamed through a window
+           of every chunk size up to MAX_CHECK_CHUNKS bytes, comparing
+           messages, with their line and column, and RPN text
+    @param path the file
+    @return the number of chunk sizes whose results differ, 1 if the
+            file cannot be read
+*/
+static size_t checkStream(const std::string& path)
+{
+    SourceFile file;
+    std::string errorMsg;
+    if (!file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+    Scanner memoryScanner(file.data(), file.size());
+    std::string memoryRPN;
+    std::string memory = compileScanned(memoryScanner, memoryRPN);
+
+    size_t mismatches = 0;
+    for (size_t chunk = 1; chunk <= MAX_CHECK_CHUNKS; chunk++) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Error: Could not open file " << path << std::endl;
+            return mismatches + 1;
+        }
+        Scanner scanner(fd, chunk);
+        std::string rpn;
+        if (compileScanned(scanner, rpn) != memory || rpn != memoryRPN) {
+            std::cerr << path << ": streaming in " << chunk << " byte chunks differs from the in-memory compile"
+                      << std::endl;
+            mismatches++;
+        }
+        close(fd);
+    }
+    return mismatches;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    ProgramGenerator::Options options;
+    options.bytes = 8 << 20;
+    int reps = 9;
+    unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+    bool allShapes = true;
+    std::string emitPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--shape=", 0) == 0) {
+            std::string name = arg.substr(8);
+            allShapes = name == "all";
+            if (!allShapes && !ProgramGenerator::parseShape(name, options.shape)) {
+                std::cerr << "Error: Unknown shape " << name << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--size=", 0) == 0) {
+            options.bytes = static_cast<size_t>(std::atof(arg.c_str() + 7) * (1 << 20));
+        } else if (arg.rfind("--reps=", 0) == 0) {
+            reps = std::max(1, std::atoi(arg.c_str() + 7));
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            options.seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else if (arg.rfind("--depth=", 0) == 0) {
+            options.depth = std::max(0, std::atoi(arg.c_str() + 8));
+        } else if (arg.rfind("--terms=", 0) == 0) {
+            options.terms = std::max(1, std::atoi(arg.c_str() + 8));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            threads = static_cast<unsigned>(std::max(1, std::atoi(arg.c_str() + 10)));
+        } else if (arg.rfind("--emit=", 0) == 0) {
+            emitPath = arg.substr(7);
+        } else if (arg == "--check-lex") {
+            size_t mismatches = 0;
+            for (i++; i < argc; i++) {
+                mismatches += checkLex(argv[i]);
+            }
+            std::cout << "parallel lex against serial lex: " << mismatches << " mismatches" << std::endl;
+            return mismatches == 0 ? 0 : 1;
+        } else if (arg == "--check-parse") {
+            size_t mismatches = 0;
+            for (i++; i < argc; i++) {
+                mismatches += checkParse(argv[i]);
+            }
+            std::cout << "parallel parse against serial parse: " << mismatches << " mismatches" << std::endl;
+            return mismatches == 0 ? 0 : 1;
+        } else if (arg == "--check-stream") {
+            size_t mismatches = 0;
+            for (i++; i < argc; i++) {
+                mismatches += checkStream(argv[i]);
+            }
+            std::cout << "streamed compile against in-memory compile: " << mismatches << " mismatches" << std::endl;
+            return mismatches == 0 ? 0 : 1;
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--shape=NAME|all] [--size=MB] [--reps=N] [--seed=N] [--depth=N] [--terms=N] [--threads=N] [--emit=PATH] [--check-lex FILE...] [--check-parse FILE...] [--check-stream FILE...]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    if (!emitPath.empty()) {
+        if (allShapes) {
+            options.shape = ProgramGenerator::Shape::MIXED;
+        }
+        std::string errorMsg;
+        if (!writeFile(emitPath, ProgramGenerator(options).generate(), errorMsg)) {
+            std::cerr << "Error: " << errorMsg << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::cout << "Each phase: one warm-up run, then the median of " << reps
+              << " runs; +/- is their relative standard deviation" << std::endl;
+    bool ok = true;
+    for (size_t i = 0; i < static_cast<size_t>(ProgramGenerator::Shape::COUNT); i++) {
+        ProgramGenerator::Shape shape = static_cast<ProgramGenerator::Shape>(i);
+        if (!allShapes && shape != options.shape) {
+            continue;
+        }
+        options.shape = shape;
+        std::string source = ProgramGenerator(options).generate();
+        source.push_back(Scanner::EOI);
+        ok = benchmark(shape, source, reps, threads) && ok;
+    }
+    return ok ? 0 : 1;
+}
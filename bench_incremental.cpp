@@ -0,0 +1,198 @@
+/***************************************************************
+  Student Name: Trevor Mee
+  File Name: bench_incremental.cpp
+  Project 2
+
+  @brief Edit-latency benchmark and self-check for the incremental
+         compiler. Applies random one-character edits to a program,
+         each followed by its undo, and times IncrementalCompiler::edit.
+         With --check every result is compared against a full compile
+         of the same source: legality, messages and RPN text. With
+         --keep the edits are not undone, so the program drifts through
+         illegal states.
+
+         usage: bench_incremental [file] [edits] [--check] [--keep]
+***************************************************************/
+
+#include "incremental.hpp"
+#include "parser.hpp"
+#include "rpn_writer.hpp"
+#include "source_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+// characters inserted by the random edits
+static const char EDIT_CHARS[] = "abxyz0179 ;=+-*/()\n~";
+
+
+/*
+    @brief compiles a source from scratch, as proj2 would
+    @param(s) name the program's name in messages
+              source the program, without the EOI sentinel
+              log receives every message
+              rpn receives the RPN text if the program is legal
+    @return true if the program is legal
+*/
+static bool fullCompile(const std::string& name, std::string_view source, std::string& log, std::string& rpn)
+{
+    std::string text(source);
+    text.push_back(Scanner::EOI);
+    std::ostringstream messages;
+    Scanner scanner(text.data(), text.size());
+    scanner.setOutput(messages);
+    Parser parser(scanner, messages, messages);
+    OutputOptions output;
+    output.text = false;
+    parser.setOutputOptions(output);
+
+    bool ok = parser.parse(name);
+    rpn.clear();
+    if (ok) {
+        RPNWriter(RPNWriter::Format::TEXT).format(parser.getIR(), rpn);
+    }
+    log = messages.str();
+    return ok;
+}
+
+
+/*
+    @brief compares the incremental compiler's state with a full compile
+    @param(s) compiler the incremental compiler
+              name the program's name in messages
+    @return true if they agree
+*/
+static bool matchesFullCompile(IncrementalCompiler& compiler, const std::string& name)
+{
+    std::string log;
+    std::string rpn;
+    bool ok = fullCompile(name, compiler.source(), log, rpn);
+    if (ok != compiler.legal() || log != compiler.log()) {
+        return false;
+    }
+    if (ok) {
+        std::string incremental;
+        RPNWriter(RPNWriter::Format::TEXT).format(compiler.program(), incremental);
+        return incremental == rpn;
+    }
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    std::string path = "a7.in";
+    size_t edits = 1000;
+    bool check = false;
+    bool keep = false;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else if (std::strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else if (positional++ == 0) {
+            path = argv[i];
+        } else {
+            edits = std::strtoul(argv[i], nullptr, 10);
+        }
+    }
+
+    SourceFile file;
+    std::string errorMsg;
+    if (!file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+    std::string_view original(file.data(), file.size() - 1);
+
+    IncrementalCompiler compiler(path);
+    auto loadStart = std::chrono::steady_clock::now();
+    compiler.load(original);
+    double loadMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - loadStart).count();
+    size_t mismatches = check && !matchesFullCompile(compiler, path) ? 1 : 0;
+
+    std::mt19937 random(12345);
+    std::vector<double> latencies;
+    size_t reparsed = 0;
+    size_t relexed = 0;
+    size_t full = 0;
+    size_t legal = 0;
+
+    for (size_t n = 0; n < edits; n++) {
+        std::string_view source = compiler.source();
+        size_t offset = random() % (source.size() + 1);
+        size_t erased = 0;
+        std::string inserted;
+        switch (random() % 3) {
+            case 0: {
+                // change a digit, which keeps a legal program legal
+                size_t digit = source.find_first_of("0123456789", offset);
+                if (digit != std::string_view::npos) {
+                    offset = digit;
+                    erased = 1;
+                    inserted = std::string(1, static_cast<char>('0' + random() % 10));
+                    break;
+                }
+                inserted = "1";
+                break;
+            }
+            case 1:
+                inserted = std::string(1, EDIT_CHARS[random() % (sizeof(EDIT_CHARS) - 1)]);
+                break;
+            default:
+                erased = offset < source.size() ? 1 : 0;
+                break;
+        }
+        std::string removed(source.substr(offset, erased));
+
+        // the edit, then its undo
+        for (int undo = 0; undo < (keep ? 1 : 2); undo++) {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = undo == 0 ? compiler.edit(offset, erased, inserted) : compiler.edit(offset, inserted.size(), removed);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+            const IncrementalCompiler::EditStats& stats = compiler.lastEdit();
+            reparsed += stats.reparsed;
+            relexed += stats.relexed;
+            full += stats.full;
+            legal += ok;
+            if (check && !matchesFullCompile(compiler, path)) {
+                if (mismatches++ < 5) {
+                    std::cerr << "Mismatch after " << (undo ? "undoing " : "") << "edit at " << offset << ": erased "
+                              << erased << ", inserted \"" << inserted << "\"" << std::endl;
+                }
+            }
+        }
+    }
+    if (!keep && compiler.source() != original) {
+        std::cerr << "Error: undoing every edit did not restore the source" << std::endl;
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double mean = 0;
+    for (double micros : latencies) {
+        mean += micros;
+    }
+    size_t count = std::max<size_t>(latencies.size(), 1);
+    mean /= count;
+
+    std::cout << path << ": " << compiler.statementCount() << " statements, full compile " << loadMicros << " us"
+              << std::endl;
+    if (!latencies.empty()) {
+        std::cout << latencies.size() << " edits (" << legal << " legal, " << full << " full re-parses): mean "
+                  << mean << " us, p50 " << latencies[(count - 1) / 2] << " us, p99 "
+                  << latencies[(count - 1) * 99 / 100] << " us, max " << latencies.back() << " us" << std::endl;
+        std::cout << "per edit: " << static_cast<double>(reparsed) / count << " statements re-parsed, "
+                  << static_cast<double>(relexed) / count << " bytes re-scanned" << std::endl;
+    }
+    if (check) {
+        std::cout << "check against full compile: " << mismatches << " mismatches" << std::endl;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/***************************************************************
+  Student Name: Trevor Mee
+  File Name: bench_keywords.cpp
+  Project 2
+
+  @brief Microbenchmark for keyword recognition: the perfect hash
+         used by Scanner::keywordKind against the unordered_map
+         lookup it replaced, over the words of a source file
+***************************************************************/
+
+#include "scanner.hpp"
+#include "source_file.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <unordered_map>
+
+
+// the lookup Scanner::ID used before the perfect hash
+static const std::unordered_map<std::string_view, TokenKind> MAP_TABLE = {
+    {"while",  TokenKind::whileSym},
+    {"return", TokenKind::returnSym},
+    {"if",     TokenKind::ifSym},
+    {"else",   TokenKind::elseSym},
+    {"do",     TokenKind::doSym},
+    {"int",    TokenKind::intSym},
+    {"string", TokenKind::stringSym},
+    {"begin",  TokenKind::beginSym},
+    {"end.",   TokenKind::endSym},
+    {"var",    TokenKind::varSym}
+};
+
+
+/*
+    @brief classifies a word with the old unordered_map lookup
+    @param word the word
+    @return the keyword's token type, or identifier
+*/
+static TokenKind mapKind(std::string_view word)
+{
+    auto found = MAP_TABLE.find(word);
+    return found != MAP_TABLE.end() ? found->second : TokenKind::identifier;
+}
+
+
+/*
+    @brief times repeated passes of a classifier over the words
+    @param(s) words the words to classify
+              rounds number of passes
+              classify the classifier
+              keywords receives the number of keywords found per pass
+    @return the best time of one pass, in seconds
+*/
+template <typename Classify>
+static double timeLookups(const std::vector<std::string_view>& words, int rounds,
+                          Classify classify, size_t& keywords)
+{
+    double best = 0;
+    for (int r = 0; r < rounds; r++) {
+        auto start = std::chrono::steady_clock::now();
+        size_t found = 0;
+        for (std::string_view word : words) {
+            found += (classify(word) != TokenKind::identifier);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+        keywords = found;
+    }
+    return best;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    std::string path = argc > 1 ? argv[1] : "a7.in";
+    size_t target = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4000000;
+    int rounds = 7;
+
+    SourceFile file;
+    std::string errorMsg;
+    if (!file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+
+    // the words ID() would classify: a letter, then letters, digits,
+    // '_' and '.'
+    std::vector<std::string_view> words;
+    std::string_view text(file.data(), file.size() - 1);
+    for (size_t i = 0; i < text.size();) {
+        if (CharClass::is(text[i], CharClass::LETTER)) {
+            size_t start = i;
+            while (i < text.size() && CharClass::is(text[i], CharClass::LETTER_OR_DIGIT)) {
+                i++;
+            }
+            words.push_back(text.substr(start, i - start));
+        } else {
+            i++;
+        }
+    }
+    if (words.empty()) {
+        std::cerr << "Error: " << path << " has no identifiers" << std::endl;
+        return 1;
+    }
+
+    // scale the input up by repeating its words
+    size_t unique = words.size();
+    while (words.size() < target) {
+        words.push_back(words[words.size() % unique]);
+    }
+
+    size_t mapKeywords = 0;
+    size_t hashKeywords = 0;
+    double mapSeconds = timeLookups(words, rounds, mapKind, mapKeywords);
+    double hashSeconds = timeLookups(words, rounds, Scanner::keywordKind, hashKeywords);
+    if (mapKeywords != hashKeywords) {
+        std::cerr << "Error: lookups disagree (" << mapKeywords << " vs " << hashKeywords << " keywords)" << std::endl;
+        return 1;
+    }
+
+    std::cout << path << ": " << words.size() << " words, " << hashKeywords << " keywords, best of " << rounds << std::endl;
+    std::cout << "unordered_map: " << mapSeconds * 1e9 / words.size() << " ns/word" << std::endl;
+    std::cout << "perfect hash:  " << hashSeconds * 1e9 / words.size() << " ns/word" << std::endl;
+    std::cout << "speedup:       " << mapSeconds / (hashSeconds > 0 ? hashSeconds : 1e-9) << "x" << std::endl;
+    return 0;
+}
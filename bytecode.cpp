@@ -0,0 +1,398 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: bytecode.cpp
+ *  Project 2
+ *
+ *  @brief Contains the bytecode writer and the mmap-based loader
+ ***************************************************************/
+
+#include "bytecode.hpp"
+#include "source_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+static_assert(sizeof(Instr) == 8 && alignof(Instr) <= 8, "Instr layout is part of the file format");
+
+/*
+    @brief rounds a section offset up to the next 8-byte boundary
+    @param offset the offset
+    @return the aligned offset
+*/
+static size_t align8(size_t offset)
+{
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+
+/*
+    @brief encodes a program in the bytecode file format
+    @param(s) program the IR to encode
+              image receives the file contents
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool encodeBytecode(const IRProgram& program, std::string& image, std::string& errorMsg)
+{
+    // label table: where each LABEL pseudo-instruction sits; a linked
+    // program needs none
+    std::vector<uint32_t> labels;
+    for (size_t i = 0; i < program.code.size() && !program.linked; i++) {
+        const Instr& instr = program.code[i];
+        if (instr.op == Op::BZ || instr.op == Op::BR || instr.op == Op::LABEL) {
+            size_t label = static_cast<size_t>(instr.arg);
+            if (labels.size() <= label) {
+                labels.resize(label + 1, BytecodeImage::NO_LABEL);
+            }
+            if (instr.op == Op::LABEL) {
+                labels[label] = static_cast<uint32_t>(i);
+            }
+        }
+    }
+
+    size_t symbolCount = program.symbolCount();
+    size_t codeOffset = align8(sizeof(BytecodeHeader));
+    size_t symbolOffset = align8(codeOffset + program.code.size() * sizeof(Instr));
+    size_t poolOffset = symbolOffset + symbolCount * 2 * sizeof(uint32_t);
+    size_t poolSize = 0;
+    for (size_t i = 0; i < symbolCount; i++) {
+        poolSize += program.symbolName(static_cast<int32_t>(i)).size();
+    }
+    size_t labelOffset = align8(poolOffset + poolSize);
+    size_t fileSize = labelOffset + labels.size() * sizeof(uint32_t);
+    if (fileSize > 0xFFFFFFFFu) {
+        errorMsg = "Program too large for bytecode version 1";
+        return false;
+    }
+
+    image.assign(fileSize, '\0');
+    BytecodeHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "RPNB", 4);
+    header.version = BytecodeImage::VERSION;
+    header.flags = program.linked ? BytecodeImage::FLAG_LINKED : 0;
+    header.instructionCount = static_cast<uint32_t>(program.code.size());
+    header.symbolCount = static_cast<uint32_t>(symbolCount);
+    header.labelCount = static_cast<uint32_t>(labels.size());
+    header.codeOffset = static_cast<uint32_t>(codeOffset);
+    header.symbolOffset = static_cast<uint32_t>(symbolOffset);
+    header.labelOffset = static_cast<uint32_t>(labelOffset);
+    header.fileSize = static_cast<uint32_t>(fileSize);
+    std::memcpy(&image[0], &header, sizeof(header));
+
+    // copy field by field so padding bytes are always zero
+    for (size_t i = 0; i < program.code.size(); i++) {
+        char* slot = &image[codeOffset + i * sizeof(Instr)];
+        std::memcpy(slot + offsetof(Instr, op), &program.code[i].op, sizeof(Op));
+        std::memcpy(slot + offsetof(Instr, arg), &program.code[i].arg, sizeof(int32_t));
+    }
+
+    size_t poolAt = 0;
+    for (size_t i = 0; i < symbolCount; i++) {
+        const std::string& name = program.symbolName(static_cast<int32_t>(i));
+        uint32_t entry[2] = { static_cast<uint32_t>(poolAt), static_cast<uint32_t>(name.size()) };
+        std::memcpy(&image[symbolOffset + i * sizeof(entry)], entry, sizeof(entry));
+        std::memcpy(&image[poolOffset + poolAt], name.data(), name.size());
+        poolAt += name.size();
+    }
+
+    if (!labels.empty()) {
+        std::memcpy(&image[labelOffset], labels.data(), labels.size() * sizeof(uint32_t));
+    }
+
+    return true;
+}
+
+
+/*
+    @brief writes a program as a bytecode file
+    @param(s) program the IR to write
+              path the output file
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool writeBytecode(const IRProgram& program, const std::string& path, std::string& errorMsg)
+{
+    std::string image;
+    return encodeBytecode(program, image, errorMsg) && writeFile(path, image, errorMsg);
+}
+
+
+/*
+    @brief Default constructor
+    @return N/A
+*/
+BytecodeImage::BytecodeImage() : base(nullptr), length(0), header(nullptr) {}
+
+
+/*
+    @brief Destructor, unmaps the file
+    @return N/A
+*/
+BytecodeImage::~BytecodeImage()
+{
+    release();
+}
+
+
+/*
+    @brief maps a bytecode file read-only and checks that every
+           section lies inside it, after which it is used in place
+    @param(s) path the bytecode file
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool BytecodeImage::open(const std::string& path, std::string& errorMsg)
+{
+    release();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errorMsg = "Could not open file " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(BytecodeHeader)) {
+        errorMsg = path + " is not a bytecode file";
+        close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        errorMsg = std::string("mmap failed: ") + std::strerror(errno);
+        return false;
+    }
+
+    base = static_cast<const char*>(mapped);
+    length = size;
+    header = reinterpret_cast<const BytecodeHeader*>(base);
+    if (!validate(errorMsg)) {
+        errorMsg = path + ": " + errorMsg;
+        release();
+        return false;
+    }
+    return true;
+}
+
+
+/*
+    @brief checks the header and the bounds of every section
+    @param errorMsg receives the reason on failure
+    @return true if the image is usable, false otherwise
+*/
+bool BytecodeImage::validate(std::string& errorMsg) const
+{
+    if (std::memcmp(header->magic, "RPNB", 4) != 0) {
+        errorMsg = "not a bytecode file";
+        return false;
+    }
+    if (header->version != VERSION) {
+        errorMsg = "unsupported bytecode version " + std::to_string(header->version);
+        return false;
+    }
+    if ((header->flags & ~FLAG_LINKED) != 0) {
+        errorMsg = "unsupported bytecode flags " + std::to_string(header->flags);
+        return false;
+    }
+
+    uint64_t codeEnd = header->codeOffset + uint64_t(header->instructionCount) * sizeof(Instr);
+    uint64_t symbolsEnd = header->symbolOffset + uint64_t(header->symbolCount) * 2 * sizeof(uint32_t);
+    uint64_t labelsEnd = header->labelOffset + uint64_t(header->labelCount) * sizeof(uint32_t);
+    if (header->fileSize != length || codeEnd > length || symbolsEnd > length || labelsEnd > length ||
+        header->codeOffset % 8 != 0 || header->symbolOffset % 4 != 0 || header->labelOffset % 4 != 0) {
+        errorMsg = "truncated or corrupt bytecode";
+        return false;
+    }
+
+    // symbol ids are slots, so two slots may not share a name
+    std::unordered_set<std::string_view> names;
+    names.reserve(header->symbolCount);
+    for (uint32_t i = 0; i < header->symbolCount; i++) {
+        const uint32_t* entry = reinterpret_cast<const uint32_t*>(base + header->symbolOffset) + 2 * i;
+        if (symbolsEnd + entry[0] + uint64_t(entry[1]) > header->labelOffset) {
+            errorMsg = "corrupt symbol table";
+            return false;
+        }
+        if (!names.insert(symbolName(i)).second) {
+            errorMsg = "duplicate symbol " + std::string(symbolName(i)) + " at slot " + std::to_string(i);
+            return false;
+        }
+    }
+
+    const Instr* instrs = code();
+    for (uint32_t i = 0; i < header->instructionCount; i++) {
+        Op op = instrs[i].op;
+        if (op >= Op::COUNT) {
+            errorMsg = "invalid opcode at instruction " + std::to_string(i);
+            return false;
+        }
+        bool symbol = (op == Op::EVAL || op == Op::STORE);
+        bool label = (op == Op::BZ || op == Op::BR || op == Op::LABEL);
+        bool linked = isLinked();
+        if ((symbol && static_cast<uint32_t>(instrs[i].arg) >= header->symbolCount) ||
+            (label && linked && (op == Op::LABEL || static_cast<uint32_t>(instrs[i].arg) > header->instructionCount)) ||
+            (label && !linked && static_cast<uint32_t>(instrs[i].arg) >= header->labelCount)) {
+            errorMsg = "operand out of range at instruction " + std::to_string(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/*
+    @brief unmaps the file
+    @return N/A
+*/
+void BytecodeImage::release()
+{
+    if (base != nullptr) {
+        munmap(const_cast<char*>(base), length);
+    }
+    base = nullptr;
+    length = 0;
+    header = nullptr;
+}
+
+
+/*
+    @brief gets the instruction stream
+    @return pointer to the first instruction
+*/
+const Instr* BytecodeImage::code() const
+{
+    return reinterpret_cast<const Instr*>(base + header->codeOffset);
+}
+
+
+/*
+    @brief gets the number of instructions
+    @return the instruction count
+*/
+size_t BytecodeImage::instructionCount() const
+{
+    return header->instructionCount;
+}
+
+
+/*
+    @brief gets the number of symbols
+    @return the symbol count
+*/
+size_t BytecodeImage::symbolCount() const
+{
+    return header->symbolCount;
+}
+
+
+/*
+    @brief gets a symbol name straight from the mapped name pool
+    @param id the symbol id
+    @return the symbol name
+*/
+std::string_view BytecodeImage::symbolName(uint32_t id) const
+{
+    const uint32_t* entry = reinterpret_cast<const uint32_t*>(base + header->symbolOffset) + 2 * id;
+    const char* pool = base + header->symbolOffset + size_t(header->symbolCount) * 2 * sizeof(uint32_t);
+    return std::string_view(pool + entry[0], entry[1]);
+}
+
+
+/*
+    @brief checks if branch operands are instruction indexes
+    @return true for a linked program
+*/
+bool BytecodeImage::isLinked() const
+{
+    return (header->flags & FLAG_LINKED) != 0;
+}
+
+
+/*
+    @brief gets the number of labels
+    @return the label count
+*/
+size_t BytecodeImage::labelCount() const
+{
+    return header->labelCount;
+}
+
+
+/*
+    @brief gets the index of the LABEL instruction for a label
+    @param label the label number
+    @return the instruction index, or NO_LABEL if it is never placed
+*/
+uint32_t BytecodeImage::labelTarget(uint32_t label) const
+{
+    return reinterpret_cast<const uint32_t*>(base + header->labelOffset)[label];
+}
+
+
+/*
+    @brief copies the image into an IRProgram, keeping symbol ids;
+           validate() made sure no two slots share a name, so each
+           name interns to its own slot
+    @param program receives the instructions and symbols
+    @return N/A
+*/
+void BytecodeImage::toIR(IRProgram& program) const
+{
+    program = IRProgram();
+    for (uint32_t i = 0; i < header->symbolCount; i++) {
+        program.intern(symbolName(i));
+    }
+    program.code.assign(code(), code() + header->instructionCount);
+    program.linked = isLinked();
+}
+
+
+/*
+    @brief loads RPN from a bytecode file or RPN text, judging by
+           the file's magic number
+    @param(s) path the input file
+              program receives the IR
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool loadRPNFile(const std::string& path, IRProgram& program, std::string& errorMsg)
+{
+    // only the magic number is read; bytecode is then mapped in place
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errorMsg = "Could not open file " + path;
+        return false;
+    }
+    char magic[4];
+    ssize_t got = read(fd, magic, sizeof(magic));
+    close(fd);
+
+    if (got == static_cast<ssize_t>(sizeof(magic)) && std::memcmp(magic, "RPNB", sizeof(magic)) == 0) {
+        BytecodeImage image;
+        if (!image.open(path, errorMsg)) {
+            return false;
+        }
+        image.toIR(program);
+        return true;
+    }
+
+    SourceFile file;
+    if (!file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        return false;
+    }
+    std::string_view text(file.data(), file.size() - 1);
+    if (!program.parseText(text, errorMsg)) {
+        errorMsg = path + ": " + errorMsg;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: bytecode.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the binary bytecode file format, its
+ *         writer, and a loader that maps a file and uses it in
+ *         place without parsing.
+ *
+ *         Layout (little-endian, every section 8-byte aligned):
+ *           header   BytecodeHeader
+ *           code     instructionCount x Instr {u8 op, 3 pad, i32 arg}
+ *           symbols  symbolCount x {u32 offset, u32 length} into the
+ *                    name pool that follows them
+ *           labels   labelCount x u32, the index of each LABEL
+ *                    instruction, or NO_LABEL if it is never placed
+ *
+ *         A linked program sets FLAG_LINKED and has no labels: branch
+ *         operands are instruction indexes, up to instructionCount.
+ ***************************************************************/
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "ir.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct BytecodeHeader {
+    char magic[4];              // "RPNB"
+    uint16_t version;           // BytecodeImage::VERSION
+    uint16_t flags;             // BytecodeImage::FLAG_* bits
+    uint32_t instructionCount;
+    uint32_t symbolCount;
+    uint32_t labelCount;
+    uint32_t codeOffset;
+    uint32_t symbolOffset;
+    uint32_t labelOffset;
+    uint32_t fileSize;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(BytecodeHeader) == 40, "BytecodeHeader layout is part of the file format");
+
+bool encodeBytecode(const IRProgram& program, std::string& image, std::string& errorMsg);
+bool writeBytecode(const IRProgram& program, const std::string& path, std::string& errorMsg);
+
+class BytecodeImage {
+
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr uint32_t NO_LABEL = 0xFFFFFFFFu;
+    static constexpr uint16_t FLAG_LINKED = 1;
+
+    BytecodeImage();
+    ~BytecodeImage();
+    BytecodeImage(const BytecodeImage&) = delete;
+    BytecodeImage& operator=(const BytecodeImage&) = delete;
+
+    bool open(const std::string& path, std::string& errorMsg);
+
+    const Instr* code() const;
+    size_t instructionCount() const;
+    size_t symbolCount() const;
+    std::string_view symbolName(uint32_t id) const;
+    bool isLinked() const;
+    size_t labelCount() const;
+    uint32_t labelTarget(uint32_t label) const;
+
+    void toIR(IRProgram& program) const;
+
+private:
+    const char* base;
+    size_t length;
+    const BytecodeHeader* header;
+
+    bool validate(std::string& errorMsg) const;
+    void release();
+};
+
+bool loadRPNFile(const std::string& path, IRProgram& program, std::string& errorMsg);
+
+#endif
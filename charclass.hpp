@@ -0,0 +1,156 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: charclass.hpp
+ *  Project 2
+ *
+ *  @brief Table-driven character classification and vectorized
+ *         helpers used by the scanner to run over whitespace
+ *         and comments many bytes at a time.
+ ***************************************************************/
+
+#ifndef CHARCLASS_H
+#define CHARCLASS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+class CharClass {
+
+public:
+    // classification bits stored in the table
+    static constexpr uint8_t WHITESPACE = 1 << 0;
+    static constexpr uint8_t DIGIT = 1 << 1;
+    static constexpr uint8_t LETTER = 1 << 2;
+    static constexpr uint8_t LETTER_OR_DIGIT = 1 << 3;
+
+    /*
+        @brief checks if a character belongs to any of the given classes
+        @param(s) c the character to classify
+                  mask one or more classification bits
+        @return true if c is in one of the classes, false otherwise
+    */
+    static bool is(char c, uint8_t mask) {
+        return (TABLE[static_cast<unsigned char>(c)] & mask) != 0;
+    }
+
+    static size_t whitespaceRun(const char* p, const char* end);
+    static size_t findLineEnd(const char* p, const char* end, char eoi);
+
+private:
+    static constexpr std::array<uint8_t, 256> makeTable() {
+        std::array<uint8_t, 256> t{};
+        t[' '] = t['\t'] = t['\n'] = t['\r'] = WHITESPACE;
+        for (int c = '0'; c <= '9'; c++) { t[c] = DIGIT | LETTER_OR_DIGIT; }
+        for (int c = 'A'; c <= 'Z'; c++) { t[c] = LETTER | LETTER_OR_DIGIT; }
+        for (int c = 'a'; c <= 'z'; c++) { t[c] = LETTER | LETTER_OR_DIGIT; }
+        t['_'] = t['.'] = LETTER_OR_DIGIT;
+        return t;
+    }
+
+    static const std::array<uint8_t, 256> TABLE;
+};
+
+inline constexpr std::array<uint8_t, 256> CharClass::TABLE = CharClass::makeTable();
+
+
+/*
+    @brief counts the whitespace characters at the start of [p, end)
+    @param(s) p first character to look at
+              end one past the last readable character
+    @return length of the whitespace run
+*/
+inline size_t CharClass::whitespaceRun(const char* p, const char* end)
+{
+    const char* start = p;
+
+#if defined(__AVX2__)
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, tab)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, cr)));
+        uint32_t wsMask = static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+        if (wsMask != 0xFFFFFFFFu) {
+            return (p - start) + __builtin_ctz(~wsMask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i sp16 = _mm_set1_epi8(' ');
+    const __m128i tab16 = _mm_set1_epi8('\t');
+    const __m128i nl16 = _mm_set1_epi8('\n');
+    const __m128i cr16 = _mm_set1_epi8('\r');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp16), _mm_cmpeq_epi8(v, tab16)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, nl16), _mm_cmpeq_epi8(v, cr16)));
+        uint32_t wsMask = static_cast<uint32_t>(_mm_movemask_epi8(ws));
+        if (wsMask != 0xFFFFu) {
+            return (p - start) + __builtin_ctz(~wsMask);
+        }
+        p += 16;
+    }
+#endif
+
+    // scalar tail (and fallback when no SIMD is available)
+    while (p < end && is(*p, WHITESPACE)) {
+        p++;
+    }
+    return p - start;
+}
+
+
+/*
+    @brief finds the end of a comment line in [p, end)
+    @param(s) p first character to look at
+              end one past the last readable character
+              eoi the end of input marker, which also ends a comment
+    @return offset of the first '\n' or eoi, or end - p if neither occurs
+*/
+inline size_t CharClass::findLineEnd(const char* p, const char* end, char eoi)
+{
+    const char* start = p;
+
+#if defined(__AVX2__)
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i stop = _mm256_set1_epi8(eoi);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, stop))));
+        if (mask != 0) {
+            return (p - start) + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i nl16 = _mm_set1_epi8('\n');
+    const __m128i stop16 = _mm_set1_epi8(eoi);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, nl16), _mm_cmpeq_epi8(v, stop16))));
+        if (mask != 0) {
+            return (p - start) + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+
+    while (p < end && *p != '\n' && *p != eoi) {
+        p++;
+    }
+    return p - start;
+}
+
+#endif
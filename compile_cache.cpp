@@ -0,0 +1,372 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: compile_cache.cpp
+ *  Project 2
+ *
+ *  @brief Contains the compile cache: key hashing, the entry file
+ *         format, atomic stores and LRU eviction
+ ***************************************************************/
+
+#include "compile_cache.hpp"
+#include "source_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// entry file header, followed by the four blobs in this order
+struct EntryHeader {
+    char magic[4];               // "RPNC"
+    uint32_t version;            // ENTRY_VERSION
+    uint32_t ok;
+    uint32_t reserved;
+    uint64_t sizes[5];           // log, errors, rpn, bytecode, symbols
+};
+
+static constexpr uint32_t ENTRY_VERSION = 2;
+static constexpr int ENTRY_PARTS = 5;
+
+// temporary files older than this were left by a writer that died
+static constexpr auto STALE_TEMP = std::chrono::hours(1);
+
+/*
+    @brief SHA-256 (FIPS 180-4), so two compiles only share an entry
+           if their inputs are the same
+*/
+class KeyHasher {
+
+public:
+    /*
+        @brief adds bytes to the hash
+        @param(s) data the bytes
+                  size how many
+        @return N/A
+    */
+    void update(const char* data, size_t size) {
+        length += size;
+        while (size > 0) {
+            size_t take = std::min(size, sizeof(block) - used);
+            std::memcpy(block + used, data, take);
+            used += take;
+            data += take;
+            size -= take;
+            if (used == sizeof(block)) {
+                compress();
+                used = 0;
+            }
+        }
+    }
+
+    /*
+        @brief formats the hash of everything added so far
+        @return 64 hex digits
+    */
+    std::string hex() const {
+        KeyHasher last = *this;
+        uint64_t bits = length * 8;
+        last.block[last.used++] = static_cast<unsigned char>(0x80);
+        if (last.used > sizeof(block) - 8) {
+            std::memset(last.block + last.used, 0, sizeof(block) - last.used);
+            last.compress();
+            last.used = 0;
+        }
+        std::memset(last.block + last.used, 0, sizeof(block) - 8 - last.used);
+        for (int i = 0; i < 8; i++) {
+            last.block[sizeof(block) - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+        }
+        last.compress();
+
+        static const char DIGITS[] = "0123456789abcdef";
+        std::string text;
+        for (uint32_t word : last.state) {
+            for (int shift = 28; shift >= 0; shift -= 4) {
+                text.push_back(DIGITS[(word >> shift) & 15]);
+            }
+        }
+        return text;
+    }
+
+private:
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    unsigned char block[64];
+    size_t used = 0;            // bytes waiting in block
+    uint64_t length = 0;
+
+    static uint32_t rotate(uint32_t x, int bits) {
+        return (x >> bits) | (x << (32 - bits));
+    }
+
+    // mixes one full block into state
+    void compress() {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = static_cast<uint32_t>(block[4 * i]) << 24 | static_cast<uint32_t>(block[4 * i + 1]) << 16
+                 | static_cast<uint32_t>(block[4 * i + 2]) << 8 | block[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t v[8];
+        std::copy(state, state + 8, v);
+        for (int i = 0; i < 64; i++) {
+            uint32_t s1 = rotate(v[4], 6) ^ rotate(v[4], 11) ^ rotate(v[4], 25);
+            uint32_t choose = (v[4] & v[5]) ^ (~v[4] & v[6]);
+            uint32_t t1 = v[7] + s1 + choose + K[i] + w[i];
+            uint32_t s0 = rotate(v[0], 2) ^ rotate(v[0], 13) ^ rotate(v[0], 22);
+            uint32_t majority = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+            std::copy_backward(v, v + 7, v + 8);
+            v[4] += t1;
+            v[0] = t1 + s0 + majority;
+        }
+        for (int i = 0; i < 8; i++) {
+            state[i] += v[i];
+        }
+    }
+};
+
+
+/*
+    @brief Parameterized constructor
+    @param(s) directory where entries are kept
+              maxBytes size cap for all entries together
+    @return N/A
+*/
+CompileCache::CompileCache(const std::string& directory, uint64_t maxBytes)
+    : directory(directory), maxBytes(maxBytes)
+{
+}
+
+
+/*
+    @brief creates the cache directory if needed
+    @param errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool CompileCache::open(std::string& errorMsg)
+{
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (!fs::is_directory(directory, ec)) {
+        errorMsg = "Could not create cache directory " + directory;
+        return false;
+    }
+    return true;
+}
+
+
+/*
+    @brief computes the cache key of a compile
+    @param(s) data the source bytes, without the EOI sentinel
+              size their count
+              output the options that shape the output
+    @return the key, 64 hex digits
+*/
+std::string CompileCache::key(const char* data, size_t size, const OutputOptions& output)
+{
+    std::string settings = std::string(COMPILER_VERSION)
+                         + " format=" + std::to_string(static_cast<int>(output.format))
+                         + " O" + std::to_string(output.optimize)
+                         + " link=" + std::to_string(output.link)
+                         + " bytecode=" + std::to_string(output.bytecode) + "\n";
+    KeyHasher hasher;
+    hasher.update(settings.data(), settings.size());
+    hasher.update(data, size);
+    return hasher.hex();
+}
+
+
+/*
+    @brief gets the file an entry lives in
+    @param key the entry's key
+    @return the path
+*/
+std::string CompileCache::pathFor(const std::string& key) const
+{
+    return directory + "/" + key.substr(0, 2) + "/" + key.substr(2);
+}
+
+
+/*
+    @brief reads an entry and marks it as recently used
+    @param(s) key the entry's key
+              entry receives the entry on a hit
+    @return true on a hit, false if there is no valid entry
+*/
+bool CompileCache::lookup(const std::string& key, Entry& entry)
+{
+    std::string path = pathFor(key);
+    SourceFile file;
+    std::string errorMsg;
+    bool hit = false;
+
+    if (access(path.c_str(), F_OK) == 0 && file.open(path, SourceFile::Mode::READ, errorMsg)) {
+        size_t size = file.size() - 1;
+        EntryHeader header;
+        if (size >= sizeof(header)) {
+            std::memcpy(&header, file.data(), sizeof(header));
+            uint64_t total = sizeof(header);
+            for (uint64_t part : header.sizes) {
+                total += part;
+            }
+            hit = std::memcmp(header.magic, "RPNC", 4) == 0 && header.version == ENTRY_VERSION && total == size;
+        }
+        if (hit) {
+            const char* at = file.data() + sizeof(header);
+            std::string* parts[ENTRY_PARTS] = { &entry.log, &entry.errors, &entry.rpn, &entry.bytecode,
+                                                &entry.symbols };
+            for (int i = 0; i < ENTRY_PARTS; i++) {
+                parts[i]->assign(at, header.sizes[i]);
+                at += header.sizes[i];
+            }
+            entry.ok = header.ok != 0;
+            // refresh the modification time, which eviction orders by
+            utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+        }
+    }
+
+    (hit ? hits : misses)++;
+    return hit;
+}
+
+
+/*
+    @brief adds an entry. It is written to a temporary file first and
+           renamed into place; a store that fails only costs a later
+           miss
+    @param(s) key the entry's key
+              entry what the compile produced
+    @return N/A
+*/
+void CompileCache::store(const std::string& key, const Entry& entry)
+{
+    EntryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "RPNC", 4);
+    header.version = ENTRY_VERSION;
+    header.ok = entry.ok ? 1 : 0;
+    const std::string* parts[ENTRY_PARTS] = { &entry.log, &entry.errors, &entry.rpn, &entry.bytecode,
+                                              &entry.symbols };
+    for (int i = 0; i < ENTRY_PARTS; i++) {
+        header.sizes[i] = parts[i]->size();
+    }
+
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const std::string* part : parts) {
+        contents += *part;
+    }
+
+    std::string path = pathFor(key);
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    std::string temp = directory + "/tmp-" + std::to_string(getpid()) + "-" + std::to_string(tempCounter++);
+    std::string errorMsg;
+    if (!writeFile(temp, contents, errorMsg) || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return;
+    }
+    stores++;
+
+    std::lock_guard<std::mutex> guard(lock);
+    usage += contents.size();
+    if (!scanned || usage > maxBytes) {
+        evict();
+    }
+}
+
+
+/*
+    @brief measures the cache and, if it is over its cap, deletes the
+           least recently used entries until it is 10% under. Also
+           removes temporary files abandoned by crashed writers.
+           Callers hold lock
+    @return N/A
+*/
+void CompileCache::evict()
+{
+    struct Found {
+        fs::file_time_type used;
+        uint64_t size;
+        fs::path path;
+    };
+    std::vector<Found> entries;
+    uint64_t total = 0;
+    auto now = fs::file_time_type::clock::now();
+
+    std::error_code ec;
+    for (const auto& item : fs::recursive_directory_iterator(directory, ec)) {
+        std::error_code itemError;
+        if (!item.is_regular_file(itemError)) {
+            continue;
+        }
+        fs::file_time_type used = item.last_write_time(itemError);
+        uint64_t size = item.file_size(itemError);
+        if (itemError) {
+            continue;       // removed by another process meanwhile
+        }
+        if (item.path().filename().string().rfind("tmp-", 0) == 0) {
+            if (now - used > STALE_TEMP) {
+                fs::remove(item.path(), itemError);
+            }
+            continue;
+        }
+        entries.push_back({used, size, item.path()});
+        total += size;
+    }
+    scanned = true;
+
+    if (total > maxBytes) {
+        std::sort(entries.begin(), entries.end(),
+                  [](const Found& x, const Found& y) { return x.used < y.used; });
+        uint64_t goal = maxBytes - maxBytes / 10;
+        for (const Found& found : entries) {
+            if (total <= goal) {
+                break;
+            }
+            std::error_code removeError;
+            if (fs::remove(found.path, removeError)) {
+                evictions++;
+            }
+            total -= found.size;
+        }
+    }
+    usage = total;
+}
+
+
+/*
+    @brief prints the hit, miss, store and eviction counts
+    @param out the stream to print to
+    @return N/A
+*/
+void CompileCache::printStats(std::ostream& out) const
+{
+    size_t lookups = hits + misses;
+    out << "Cache: " << hits << " hits, " << misses << " misses";
+    if (lookups > 0) {
+        out << " (" << 100.0 * hits / lookups << "% hit rate)";
+    }
+    out << ", " << stores << " stored, " << evictions << " evicted" << std::endl;
+}
@@ -0,0 +1,73 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: compile_cache.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the on-disk compile cache. Entries are
+ *         keyed by the SHA-256 digest of the source bytes, the compiler
+ *         version and the output options, and hold everything a
+ *         compile produces: its messages, RPN text and bytecode.
+ *
+ *         Layout: <dir>/<first 2 hex digits>/<remaining 62>. Entries
+ *         are written to a temporary file and renamed into place, so
+ *         concurrent processes only ever see whole entries. Hits
+ *         refresh an entry's modification time, and once the cache
+ *         outgrows its cap the least recently used entries go first.
+ ***************************************************************/
+
+#ifndef COMPILE_CACHE_H
+#define COMPILE_CACHE_H
+
+#include "parser.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+// part of every cache key: bump it whenever the messages, RPN or
+// bytecode produced for a program change
+inline constexpr const char* COMPILER_VERSION = "proj2-2.2";
+
+class CompileCache {
+
+public:
+    // what a compile produced
+    struct Entry {
+        bool ok = false;
+        std::string log;         // messages after "Compiling <name>..."
+        std::string errors;      // internal failures, reported on err
+        std::string rpn;         // RPN text in the requested format
+        std::string bytecode;    // bytecode file, if requested
+        std::string symbols;     // variable names in slot order, one per line
+    };
+
+    CompileCache(const std::string& directory, uint64_t maxBytes);
+    bool open(std::string& errorMsg);
+
+    static std::string key(const char* data, size_t size, const OutputOptions& output);
+    bool lookup(const std::string& key, Entry& entry);
+    void store(const std::string& key, const Entry& entry);
+    void printStats(std::ostream& out) const;
+
+private:
+    std::string directory;
+    uint64_t maxBytes;
+
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+    std::atomic<size_t> stores{0};
+    std::atomic<size_t> evictions{0};
+    std::atomic<unsigned> tempCounter{0};
+
+    std::mutex lock;             // guards usage and eviction
+    uint64_t usage = 0;          // bytes in entries, as of the last scan plus stores since
+    bool scanned = false;
+
+    std::string pathFor(const std::string& key) const;
+    void evict();
+};
+
+#endif
@@ -0,0 +1,273 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: compile_stats.cpp
+ *  Project 2
+ *
+ *  @brief Contains the --stats report and the allocation counters
+ ***************************************************************/
+
+#include "compile_stats.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sys/resource.h>
+
+static const char* const PHASE_NAMES[CompileStats::PHASE_COUNT] = {
+    "read", "scan", "parse", "optimize", "link", "write", "run"
+};
+
+// allocations made by operator new on this thread
+static thread_local uint64_t allocationCount = 0;
+static thread_local uint64_t allocationBytes = 0;
+
+
+/*
+    @brief replaces the global operator new to count allocations; the
+           array and nothrow forms all call this one. Counting is two
+           thread-local additions, far below the cost of malloc, so it
+           is always on
+    @param size bytes requested
+    @return the memory, throws std::bad_alloc if there is none
+*/
+void* operator new(std::size_t size)
+{
+    allocationCount++;
+    allocationBytes += size;
+    if (size == 0) {
+        size = 1;
+    }
+    while (true) {
+        void* memory = std::malloc(size);
+        if (memory != nullptr) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+
+/*
+    @brief releases memory from the operator new above
+    @param memory the memory, may be null
+    @return N/A
+*/
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+
+/*
+    @brief sized form of operator delete
+    @param(s) memory the memory, may be null
+              size bytes that were requested
+    @return N/A
+*/
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+
+/*
+    @brief gets the printable name of a token kind, including the
+           kinds whose diagnostic name is not an identifier
+    @param kind index of the token kind
+    @return its name
+*/
+static const char* tokenName(size_t kind)
+{
+    if (kind == static_cast<size_t>(TokenKind::unknown)) {
+        return "unknown";
+    }
+    if (kind == static_cast<size_t>(TokenKind::eoi)) {
+        return "eoi";
+    }
+    return TOKEN_KIND_NAMES[kind];
+}
+
+
+/*
+    @brief gets how much this thread has allocated so far
+    @param(s) count receives the number of allocations
+              bytes receives the bytes requested
+    @return N/A
+*/
+void CompileStats::threadAllocations(uint64_t& count, uint64_t& bytes)
+{
+    count = allocationCount;
+    bytes = allocationBytes;
+}
+
+
+/*
+    @brief gets the process's peak resident set size so far
+    @return the peak in bytes, 0 if unavailable
+*/
+uint64_t CompileStats::peakResidentBytes()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;    // Linux reports KB
+}
+
+
+/*
+    @brief completes the stats of one compile on this thread: turns the
+           nextToken samples into a scan time, taken out of the parse
+           time that included it, and records the file's outcome
+    @param(s) ok whether the compile succeeded
+              sourceBytes bytes of source read
+              allocationsBefore this thread's allocation count when the compile started
+              allocatedBytesBefore this thread's allocated bytes when the compile started
+    @return N/A
+*/
+void CompileStats::finishFile(bool ok, size_t sourceBytes, uint64_t allocationsBefore, uint64_t allocatedBytesBefore)
+{
+    if (sampledTokens > 0) {
+        double scan = sampledSeconds * scannedTokens / sampledTokens;
+        scan = std::min(scan, seconds[PARSE]);
+        seconds[SCAN] += scan;
+        seconds[PARSE] -= scan;
+        scanEstimated = true;
+    }
+    scannedTokens = 0;
+    sampledTokens = 0;
+    sampledSeconds = 0;
+
+    files++;
+    failed += ok ? 0 : 1;
+    bytes += sourceBytes;
+
+    uint64_t count;
+    uint64_t allocated;
+    threadAllocations(count, allocated);
+    allocations += count - allocationsBefore;
+    allocatedBytes += allocated - allocatedBytesBefore;
+    peakRSS = std::max(peakRSS, peakResidentBytes());
+}
+
+
+/*
+    @brief adds another set of stats to these
+    @param other the stats to add
+    @return N/A
+*/
+void CompileStats::merge(const CompileStats& other)
+{
+    files += other.files;
+    failed += other.failed;
+    bytes += other.bytes;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        seconds[phase] += other.seconds[phase];
+    }
+    wallSeconds += other.wallSeconds;
+    for (size_t kind = 0; kind < static_cast<size_t>(TokenKind::COUNT); kind++) {
+        tokens[kind] += other.tokens[kind];
+    }
+    for (size_t op = 0; op < static_cast<size_t>(Op::COUNT); op++) {
+        instructions[op] += other.instructions[op];
+    }
+    symbols += other.symbols;
+    allocations += other.allocations;
+    allocatedBytes += other.allocatedBytes;
+    peakRSS = std::max(peakRSS, other.peakRSS);
+    scanEstimated = scanEstimated || other.scanEstimated;
+}
+
+
+/*
+    @brief prints the stats for people
+    @param out where to print them
+    @return N/A
+*/
+void CompileStats::print(std::ostream& out) const
+{
+    double total = 0;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        total += seconds[phase];
+    }
+    double safeTotal = total > 0 ? total : 1e-9;
+
+    out << "Stats: " << files << " files, " << failed << " failed, " << bytes << " bytes" << std::endl;
+    out << std::fixed;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        out << "  " << std::left << std::setw(10) << PHASE_NAMES[phase] << std::right << std::setprecision(6)
+            << std::setw(12) << seconds[phase] << " s" << std::setprecision(1) << std::setw(7)
+            << seconds[phase] / safeTotal * 100 << "%" << (phase == SCAN && scanEstimated ? "  (estimated)" : "")
+            << std::endl;
+    }
+    out << "  " << std::left << std::setw(10) << "total" << std::right << std::setprecision(6) << std::setw(12)
+        << total << " s" << std::endl;
+    if (wallSeconds > 0) {
+        out << "  " << std::left << std::setw(10) << "wall" << std::right << std::setw(12) << wallSeconds << " s"
+            << std::endl;
+    }
+    out << std::defaultfloat;
+
+    uint64_t tokenTotal = 0;
+    for (uint64_t count : tokens) {
+        tokenTotal += count;
+    }
+    out << "Tokens: " << tokenTotal << std::endl;
+    for (size_t kind = 0; kind < static_cast<size_t>(TokenKind::COUNT); kind++) {
+        if (tokens[kind] > 0) {
+            out << "  " << std::left << std::setw(16) << tokenName(kind) << std::right << std::setw(12)
+                << tokens[kind] << std::endl;
+        }
+    }
+
+    uint64_t instructionTotal = 0;
+    for (uint64_t count : instructions) {
+        instructionTotal += count;
+    }
+    out << "Instructions: " << instructionTotal << std::endl;
+    for (size_t op = 0; op < static_cast<size_t>(Op::COUNT); op++) {
+        if (instructions[op] > 0) {
+            out << "  " << std::left << std::setw(16) << OP_NAMES[op] << std::right << std::setw(12)
+                << instructions[op] << std::endl;
+        }
+    }
+
+    out << "Symbols: " << symbols << std::endl;
+    out << "Peak RSS: " << peakRSS / 1024 << " KB" << std::endl;
+    out << "Allocations: " << allocations << " (" << allocatedBytes << " bytes)" << std::endl;
+}
+
+
+/*
+    @brief prints the stats as one JSON object on one line. Every
+           phase, token kind and opcode is present, zero or not, so
+           the shape never changes
+    @param out where to print them
+    @return N/A
+*/
+void CompileStats::printJSON(std::ostream& out) const
+{
+    std::streamsize precision = out.precision(9);
+    out << "{\"files\":" << files << ",\"failed\":" << failed << ",\"bytes\":" << bytes
+        << ",\"wall_seconds\":" << wallSeconds << ",\"scan_estimated\":" << (scanEstimated ? "true" : "false")
+        << ",\"seconds\":{";
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        out << (phase > 0 ? "," : "") << "\"" << PHASE_NAMES[phase] << "\":" << seconds[phase];
+    }
+    out << "},\"tokens\":{";
+    for (size_t kind = 0; kind < static_cast<size_t>(TokenKind::COUNT); kind++) {
+        out << (kind > 0 ? "," : "") << "\"" << tokenName(kind) << "\":" << tokens[kind];
+    }
+    out << "},\"instructions\":{";
+    for (size_t op = 0; op < static_cast<size_t>(Op::COUNT); op++) {
+        out << (op > 0 ? "," : "") << "\"" << OP_NAMES[op] << "\":" << instructions[op];
+    }
+    out << "},\"symbols\":" << symbols << ",\"peak_rss_bytes\":" << peakRSS << ",\"allocations\":" << allocations
+        << ",\"allocated_bytes\":" << allocatedBytes << "}" << std::endl;
+    out.precision(precision);
+}
@@ -0,0 +1,92 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: compile_stats.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the counters and phase timings that
+ *         --stats reports, for one compile or summed over a batch.
+ *
+ *         Nothing is collected unless a CompileStats is attached to
+ *         the Scanner and Parser, so a normal compile only pays a
+ *         null pointer test per token. Scanning and parsing are
+ *         interleaved, so nextToken is timed for one token in every
+ *         SAMPLE_PERIOD and the scan time is estimated from those
+ *         samples; the parse time is what remains of the grammar's
+ *         run time. Timing a token disturbs it, so the estimate runs
+ *         high; with --pretokenize both are measured exactly.
+ *         Allocations are counted per thread by the global operator
+ *         new in compile_stats.cpp.
+ ***************************************************************/
+
+#ifndef COMPILE_STATS_H
+#define COMPILE_STATS_H
+
+#include "ir.hpp"
+#include "token.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+struct CompileStats {
+    // where the time goes; streamed input is read while scanning
+    enum Phase { READ, SCAN, PARSE, OPTIMIZE, LINK, WRITE, RUN, PHASE_COUNT };
+
+    // nextToken is timed for one token in every SAMPLE_PERIOD
+    static constexpr uint64_t SAMPLE_PERIOD = 64;
+
+    uint64_t files = 0;
+    uint64_t failed = 0;
+    uint64_t bytes = 0;                                         // source bytes read
+    double seconds[PHASE_COUNT] = {};
+    double wallSeconds = 0;                                     // set by the caller, 0 if unknown
+    uint64_t tokens[static_cast<size_t>(TokenKind::COUNT)] = {};
+    uint64_t instructions[static_cast<size_t>(Op::COUNT)] = {}; // as emitted, before -O1
+    uint64_t symbols = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t peakRSS = 0;                                       // bytes, for the whole process
+
+    // nextToken samples of the compile in progress
+    uint64_t scannedTokens = 0;
+    uint64_t sampledTokens = 0;
+    double sampledSeconds = 0;
+    bool scanEstimated = false;                                 // some scan time came from samples
+
+    void finishFile(bool ok, size_t sourceBytes, uint64_t allocationsBefore, uint64_t allocatedBytesBefore);
+    void merge(const CompileStats& other);
+    void print(std::ostream& out) const;
+    void printJSON(std::ostream& out) const;
+
+    static void threadAllocations(uint64_t& count, uint64_t& bytes);
+    static uint64_t peakResidentBytes();
+
+    /*
+        @brief reads the monotonic clock
+        @return seconds since an arbitrary start
+    */
+    static double now() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /*
+        @brief measures what one now() call adds to a timed interval,
+               so tiny samples are not dominated by the clock itself
+        @return the smallest of several back-to-back readings, in seconds
+    */
+    static double clockOverhead() {
+        static const double overhead = []() {
+            double least = 1;
+            for (int i = 0; i < 32; i++) {
+                double start = now();
+                double gap = now() - start;
+                least = gap < least ? gap : least;
+            }
+            return least;
+        }();
+        return overhead;
+    }
+};
+
+#endif
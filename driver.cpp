@@ -0,0 +1,521 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: driver.cpp
+ *  Project 2
+ *
+ *  @brief Contains the compiler driver: single-file compiles,
+ *         input list expansion and the multi-threaded batch mode
+ ***************************************************************/
+
+#include "driver.hpp"
+#include "parser.hpp"
+#include "register_vm.hpp"
+#include "scanner.hpp"
+#include "vm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+static CompileResult compileSource(const std::string& path, const CompileOptions& options,
+                                   std::ostream& out, std::ostream& err, CompileStats* stats);
+static CompileResult compileStream(const std::string& path, const CompileOptions& options,
+                                   std::ostream& out, std::ostream& err, CompileStats* stats);
+static bool compileCached(const SourceFile& file, const std::string& name, const CompileOptions& options,
+                          std::ostream& out, std::ostream& err, CompileStats* stats);
+static bool runTimed(const IRProgram& program, const CompileOptions& options,
+                     std::ostream& out, std::ostream& err, CompileStats* stats);
+static bool runBackend(const IRProgram& program, const CompileOptions& options,
+                       std::ostream& out, std::ostream& err);
+
+/*
+    @brief compiles one source file into <path>.txt
+    @param(s) path the file to compile, "-" for standard input
+              options how to compile it
+              out stream for progress messages and diagnostics
+              err stream for I/O and internal failures
+              stats if set, receives the compile's counters and timings
+    @return whether the compile succeeded and how many bytes were read
+*/
+CompileResult compileFile(const std::string& path, const CompileOptions& options,
+                          std::ostream& out, std::ostream& err, CompileStats* stats)
+{
+    if (stats == nullptr) {
+        return compileSource(path, options, out, err, nullptr);
+    }
+
+    // collect per file, so the scan time estimate only covers this file
+    CompileStats fileStats;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    CompileStats::threadAllocations(allocations, allocatedBytes);
+    CompileResult result = compileSource(path, options, out, err, &fileStats);
+    fileStats.finishFile(result.ok, result.bytes, allocations, allocatedBytes);
+    stats->merge(fileStats);
+    return result;
+}
+
+
+/*
+    @brief compileFile() once it is known whether stats are collected
+    @param(s) path the file to compile, "-" for standard input
+              options how to compile it
+              out stream for progress messages and diagnostics
+              err stream for I/O and internal failures
+              stats if set, receives the compile's counters and timings
+    @return whether the compile succeeded and how many bytes were read
+*/
+static CompileResult compileSource(const std::string& path, const CompileOptions& options,
+                                   std::ostream& out, std::ostream& err, CompileStats* stats)
+{
+    CompileResult result;
+    if (options.io == SourceFile::Mode::STREAM) {
+        return compileStream(path, options, out, err, stats);
+    }
+
+    // Load the source file; the scanner lexes straight from this buffer
+    double readStart = stats != nullptr ? CompileStats::now() : 0;
+    SourceFile file;
+    std::string errorMsg;
+    if (!file.open(path, options.io, errorMsg)) {
+        err << "Error: " << errorMsg << std::endl;
+        return result;
+    }
+    result.bytes = file.size() - 1;
+    if (stats != nullptr) {
+        stats->seconds[CompileStats::READ] += CompileStats::now() - readStart;
+    }
+
+    if (options.cache != nullptr) {
+        result.ok = compileCached(file, path == "-" ? "stdin" : path, options, out, err, stats);
+        return result;
+    }
+
+    // Create a Scanner instance
+    Scanner scanner(file.data(), file.size());
+    scanner.setOutput(out);
+
+    // Lex everything first if asked, timing it on its own; otherwise
+    // the parser pulls tokens and the scan time is sampled
+    TokenBuffer tokens;
+    bool pretokenized = options.pretokenize && tokens.lex(scanner, stats, options.lexThreads);
+    if (!pretokenized) {
+        scanner.setStats(stats);
+    }
+
+    // Create a Parser instance; sources average a few bytes per
+    // RPN instruction, so this usually avoids regrowing the IR
+    Parser parser(scanner, out, err, pretokenized ? &tokens : nullptr);
+    parser.reserveIR(result.bytes / 4);
+    parser.setOutputOptions(options.output);
+    parser.setStats(stats);
+    parser.setThreads(options.parseThreads);
+
+    // Parse the source code
+    result.ok = parser.parse(path == "-" ? "stdin" : path);
+    if (result.ok && options.run) {
+        result.ok = runTimed(parser.getIR(), options, out, err, stats);
+    }
+    return result;
+}
+
+
+/*
+    @brief runs a compiled program on the VM, timing it if stats are
+           collected
+    @param(s) program the program
+              options supplies the instruction limit
+              out stream for the results
+              err stream for runtime errors
+              stats if set, receives the run time
+    @return true if the program ran to completion, false otherwise
+*/
+static bool runTimed(const IRProgram& program, const CompileOptions& options,
+                     std::ostream& out, std::ostream& err, CompileStats* stats)
+{
+    if (stats == nullptr) {
+        return runBackend(program, options, out, err);
+    }
+    double start = CompileStats::now();
+    bool ok = runBackend(program, options, out, err);
+    stats->seconds[CompileStats::RUN] += CompileStats::now() - start;
+    return ok;
+}
+
+
+/*
+    @brief runs a program on the VM of the selected backend: the stack
+           VM, or the register VM after generating register code
+    @param(s) program the program
+              options supplies the backend and the instruction limit
+              out stream for the results
+              err stream for runtime errors
+    @return true if the program ran to completion, false otherwise
+*/
+static bool runBackend(const IRProgram& program, const CompileOptions& options,
+                       std::ostream& out, std::ostream& err)
+{
+    if (options.output.registers > 0) {
+        return runRegisterProgram(program, options.output.registers, out, err, options.runLimit);
+    }
+    return runProgram(program, out, err, options.runLimit);
+}
+
+
+/*
+    @brief compiles a loaded source file through the compile cache. On
+           a miss the program is compiled in memory and the result
+           stored; either way the outputs and messages come from the
+           cache entry, so they match an uncached compile
+    @param(s) file the loaded source
+              name the name used in messages and output file names
+              options how to compile it
+              out stream for progress messages and diagnostics
+              err stream for I/O and internal failures
+              stats if set, receives the compile's counters and timings
+    @return true if the program is legal and its outputs were written
+*/
+static bool compileCached(const SourceFile& file, const std::string& name, const CompileOptions& options,
+                          std::ostream& out, std::ostream& err, CompileStats* stats)
+{
+    CompileCache& cache = *options.cache;
+    std::string key = CompileCache::key(file.data(), file.size() - 1, options.output);
+    CompileCache::Entry entry;
+    IRProgram program;
+    bool compiled = false;
+    std::string errorMsg;
+
+    if (!cache.lookup(key, entry)) {
+        std::ostringstream log;
+        std::ostringstream errors;
+        Scanner scanner(file.data(), file.size());
+        scanner.setOutput(log);
+        TokenBuffer tokens;
+        bool pretokenized = options.pretokenize && tokens.lex(scanner, stats, options.lexThreads);
+        if (!pretokenized) {
+            scanner.setStats(stats);
+        }
+        Parser parser(scanner, log, errors, pretokenized ? &tokens : nullptr);
+        parser.reserveIR(file.size() / 4);
+        OutputOptions output = options.output;
+        output.text = false;
+        output.bytecode = false;
+        parser.setOutputOptions(output);
+        parser.setStats(stats);
+        parser.setThreads(options.parseThreads);
+
+        entry.ok = parser.parse(name);
+        entry.log = log.str();
+        entry.log.erase(0, entry.log.find('\n') + 1);     // "Compiling <name>..."
+        entry.errors = errors.str();
+        if (entry.ok) {
+            // the RPN text is always kept, so --run works on a hit
+            RPNWriter(options.output.format).format(parser.getIR(), entry.rpn);
+            // the RPN names variables in use order and leaves out unused
+            // ones, so the slots are kept to rebuild the same program
+            const IRProgram& ir = parser.getIR();
+            for (size_t slot = 0; slot < ir.symbolCount(); slot++) {
+                entry.symbols += ir.symbolName(static_cast<int32_t>(slot));
+                entry.symbols += '\n';
+            }
+            if (options.output.bytecode && !encodeBytecode(parser.getIR(), entry.bytecode, errorMsg)) {
+                err << "Error: " << errorMsg << std::endl;
+                return false;
+            }
+        }
+        cache.store(key, entry);
+        if (options.run || options.output.registers > 0) {
+            program = parser.getIR();
+            compiled = true;
+        }
+    }
+
+    out << "Compiling " << name << "..." << std::endl;
+    out << entry.log << std::flush;
+    err << entry.errors << std::flush;
+    if (!entry.ok) {
+        return false;
+    }
+
+    // register code is generated from the RPN, which a hit only has as
+    // text; interning the symbol table first keeps every variable's slot
+    bool needProgram = options.run || (options.output.text && options.output.registers > 0);
+    if (needProgram && !compiled) {
+        std::string_view symbols = entry.symbols;
+        while (!symbols.empty()) {
+            size_t end = symbols.find('\n');
+            program.intern(symbols.substr(0, end));
+            symbols.remove_prefix(end == std::string_view::npos ? symbols.size() : end + 1);
+        }
+        if (!program.parseText(entry.rpn, errorMsg)) {
+            err << "Error: " << errorMsg << std::endl;
+            return false;
+        }
+    }
+
+    double writeStart = stats != nullptr ? CompileStats::now() : 0;
+    bool written = true;
+    if (options.output.text && options.output.registers > 0) {
+        RegisterProgram registerCode;
+        if (generateRegisterCode(program, options.output.registers, registerCode, errorMsg)
+            && writeRegisterCode(registerCode, name + ".reg", errorMsg)) {
+            out << "Register allocator placed " << registerCode.values << " values in "
+                << registerCode.usedRegisters << " of " << registerCode.registers << " registers and "
+                << registerCode.spillSlots << " spill slots" << std::endl;
+            out << "Generated register code written to " << name << ".reg" << std::endl;
+        } else {
+            err << "Error: " << errorMsg << std::endl;
+            written = false;
+        }
+    } else if (options.output.text) {
+        auto start = std::chrono::steady_clock::now();
+        if (writeFile(name + ".txt", entry.rpn, errorMsg)) {
+            out << "Generated RPN code written to " << name << ".txt" << std::endl;
+            if (options.output.stats) {
+                // the same line the parser prints; each instruction is one line
+                RPNWriter::Stats written;
+                written.instructions = std::count(entry.rpn.begin(), entry.rpn.end(), '\n');
+                written.bytes = entry.rpn.size();
+                written.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                RPNWriter::printStats(written, out);
+            }
+        } else {
+            err << "Error: " << errorMsg << std::endl;
+            written = false;
+        }
+    }
+    if (options.output.bytecode) {
+        if (writeFile(name + ".bc", entry.bytecode, errorMsg)) {
+            out << "Generated bytecode written to " << name << ".bc" << std::endl;
+        } else {
+            err << "Error: " << errorMsg << std::endl;
+            written = false;
+        }
+    }
+
+    if (stats != nullptr) {
+        stats->seconds[CompileStats::WRITE] += CompileStats::now() - writeStart;
+    }
+
+    if (written && options.run) {
+        return runTimed(program, options, out, err, stats);
+    }
+    return written;
+}
+
+
+/*
+    @brief compiles one source file while streaming it through the
+           scanner's fixed-size window, so the whole input never
+           has to be in memory
+    @param(s) path the file to compile, "-" for standard input
+              options how to compile it
+              out stream for progress messages and diagnostics
+              err stream for I/O and internal failures
+              stats if set, receives the compile's counters and timings;
+                    reading is part of the scan time
+    @return whether the compile succeeded and how many bytes were read
+*/
+static CompileResult compileStream(const std::string& path, const CompileOptions& options,
+                                   std::ostream& out, std::ostream& err, CompileStats* stats)
+{
+    CompileResult result;
+
+    bool isStdin = (path == "-");
+    int fd = isStdin ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err << "Error: Could not open file " << path << std::endl;
+        return result;
+    }
+
+    Scanner scanner(fd, options.chunkSize);
+    scanner.setOutput(out);
+    scanner.setStats(stats);
+    Parser parser(scanner, out, err);
+    parser.setOutputOptions(options.output);
+    parser.setStats(stats);
+    result.ok = parser.parse(isStdin ? "stdin" : path);
+    result.bytes = scanner.getOffset();
+    if (result.ok && options.run) {
+        result.ok = runTimed(parser.getIR(), options, out, err, stats);
+    }
+
+    if (!isStdin) {
+        close(fd);
+    }
+    return result;
+}
+
+
+/*
+    @brief runs previously generated RPN, either text or bytecode,
+           on the VM of the selected backend
+    @param(s) path the RPN file
+              options supplies the backend and the instruction limit
+              out stream for the results
+              err stream for load and runtime errors
+    @return true if the program ran to completion, false otherwise
+*/
+bool execFile(const std::string& path, const CompileOptions& options,
+              std::ostream& out, std::ostream& err)
+{
+    IRProgram program;
+    std::string errorMsg;
+    if (!loadRPNFile(path, program, errorMsg)) {
+        err << "Error: " << errorMsg << std::endl;
+        return false;
+    }
+    return runBackend(program, options, out, err);
+}
+
+
+/*
+    @brief expands one command line input into source file paths.
+           "@list" names a file holding one path per line, and a
+           directory contributes its *.in files in sorted order
+    @param(s) arg the command line argument
+              inputs receives the paths
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool collectInputs(const std::string& arg, std::vector<std::string>& inputs, std::string& errorMsg)
+{
+    namespace fs = std::filesystem;
+
+    if (arg.size() > 1 && arg[0] == '@') {
+        std::ifstream list(arg.substr(1));
+        if (!list.is_open()) {
+            errorMsg = "Could not open list file " + arg.substr(1);
+            return false;
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                inputs.push_back(line);
+            }
+        }
+        return true;
+    }
+
+    std::error_code ec;
+    if (arg != "-" && fs::is_directory(arg, ec)) {
+        std::vector<std::string> found;
+        for (const auto& entry : fs::directory_iterator(arg, ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".in") {
+                found.push_back(entry.path().string());
+            }
+        }
+        if (ec) {
+            errorMsg = "Could not read directory " + arg;
+            return false;
+        }
+        std::sort(found.begin(), found.end());
+        inputs.insert(inputs.end(), found.begin(), found.end());
+        return true;
+    }
+
+    inputs.push_back(arg);
+    return true;
+}
+
+
+/*
+    @brief compiles many files on a pool of worker threads. Each
+           worker owns its Scanner and Parser and buffers a file's
+           messages, which are printed in input order so the output
+           does not depend on the number of threads
+    @param(s) inputs the files to compile
+              jobs number of worker threads
+              options how to compile each file
+              stats if set, receives the counters and timings of every
+                    file added together
+    @return 0 if every file compiled, 1 otherwise
+*/
+int runBatch(const std::vector<std::string>& inputs, unsigned jobs, const CompileOptions& options,
+             CompileStats* stats)
+{
+    struct Slot {
+        std::string log;
+        CompileResult result;
+        CompileStats stats;
+        bool done = false;
+    };
+
+    std::vector<Slot> slots(inputs.size());
+    std::atomic<size_t> next(0);
+    std::mutex lock;
+    std::condition_variable finished;
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        while (true) {
+            size_t i = next.fetch_add(1);
+            if (i >= inputs.size()) {
+                return;
+            }
+            std::ostringstream log;
+            CompileStats fileStats;
+            CompileResult result = compileFile(inputs[i], options, log, log, stats != nullptr ? &fileStats : nullptr);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                slots[i].log = log.str();
+                slots[i].result = result;
+                slots[i].stats = fileStats;
+                slots[i].done = true;
+            }
+            finished.notify_one();
+        }
+    };
+
+    jobs = std::max(1u, std::min<unsigned>(jobs, static_cast<unsigned>(inputs.size())));
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < jobs; t++) {
+        pool.emplace_back(worker);
+    }
+
+    // print each file's messages in input order as soon as it is done
+    size_t failures = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+        std::unique_lock<std::mutex> guard(lock);
+        finished.wait(guard, [&]() { return slots[i].done; });
+        std::string log = std::move(slots[i].log);
+        CompileResult result = slots[i].result;
+        if (stats != nullptr) {
+            stats->merge(slots[i].stats);
+        }
+        guard.unlock();
+
+        std::cout << log;
+        bytes += result.bytes;
+        if (!result.ok) {
+            failures++;
+        }
+    }
+
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double safeSeconds = seconds > 0 ? seconds : 1e-9;
+    std::cout << "---------------------------" << std::endl;
+    std::cout << "Files: " << inputs.size() << ", failed: " << failures
+              << ", threads: " << jobs << std::endl;
+    std::cout << "Time: " << seconds << " s, " << inputs.size() / safeSeconds << " files/s, "
+              << bytes / safeSeconds / (1024.0 * 1024.0) << " MB/s" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: driver.hpp
+ *  Project 2
+ *
+ *  @brief This file declares the compiler driver: compiling one
+ *         source file, and compiling many files on a pool of
+ *         worker threads.
+ ***************************************************************/
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include "source_file.hpp"
+#include "parser.hpp"
+#include "compile_cache.hpp"
+#include "compile_stats.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// options shared by every file in a run
+struct CompileOptions {
+    SourceFile::Mode io = SourceFile::Mode::MMAP;
+    size_t chunkSize = 64 * 1024;      // read size for --io=stream
+    OutputOptions output;
+    bool pretokenize = false;          // lex in-memory sources fully before parsing
+    unsigned lexThreads = 1;           // threads lexing one large source, with pretokenize
+    unsigned parseThreads = 1;         // threads parsing its statements, with pretokenize
+    bool run = false;                  // execute legal programs on the VM
+    uint64_t runLimit = 0;             // VM instruction limit, 0 for none
+    CompileCache* cache = nullptr;     // reuse earlier compiles, if set
+};
+
+// outcome of compiling a single file
+struct CompileResult {
+    bool ok = false;
+    size_t bytes = 0;
+};
+
+CompileResult compileFile(const std::string& path, const CompileOptions& options,
+                          std::ostream& out, std::ostream& err, CompileStats* stats = nullptr);
+
+bool collectInputs(const std::string& arg, std::vector<std::string>& inputs, std::string& errorMsg);
+
+bool execFile(const std::string& path, const CompileOptions& options,
+              std::ostream& out, std::ostream& err);
+
+int runBatch(const std::vector<std::string>& inputs, unsigned jobs, const CompileOptions& options,
+             CompileStats* stats = nullptr);
+
+#endif
@@ -0,0 +1,279 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: generator.cpp
+ *  Project 2
+ *
+ *  @brief Contains the synthetic program generator
+ ***************************************************************/
+
+#include "generator.hpp"
+
+#include <algorithm>
+
+static const char* const SHAPE_NAMES[] = {
+    "mixed", "declarations", "nesting", "expressions", "comments", "control"
+};
+
+static_assert(sizeof(SHAPE_NAMES) / sizeof(SHAPE_NAMES[0]) == static_cast<size_t>(ProgramGenerator::Shape::COUNT),
+              "every Shape needs a name");
+
+// variable names are one of these followed by a number
+static const char* const PREFIXES[] = { "v", "x", "sum", "tmp", "idx", "total", "acc", "count" };
+
+// words comments are made of
+static const char* const WORDS[] = {
+    "the", "loop", "counts", "down", "until", "zero", "and", "adds", "each", "value",
+    "to", "running", "total", "(see", "above)", "result;", "=", "check", "bounds", "first"
+};
+
+static const char OPERATORS[] = { '+', '-', '*', '/' };
+
+// deeper statements are not indented further
+static constexpr int MAX_INDENT = 32;
+
+
+/*
+    @brief Parameterized constructor
+    @param options the size and shape of the programs
+    @return N/A
+*/
+ProgramGenerator::ProgramGenerator(const Options& options) : options(options), random(options.seed)
+{
+}
+
+
+/*
+    @brief writes one program
+    @return the program's source
+*/
+std::string ProgramGenerator::generate()
+{
+    std::string out;
+    out.reserve(options.bytes + 4096);
+    out += "begin\n";
+
+    names.clear();
+    if (options.shape == Shape::DECLARATIONS) {
+        // nine tenths of the program is declarations
+        while (out.size() < options.bytes - options.bytes / 10) {
+            declare(out, 256, 16);
+        }
+    } else {
+        declare(out, std::max(options.variables, 1), 8);
+    }
+    out += "\n";
+
+    while (out.size() < options.bytes) {
+        switch (options.shape) {
+            case Shape::NESTING:
+                statement(out, options.depth, 1);
+                break;
+            case Shape::EXPRESSIONS:
+                out += "  ";
+                out += names[pick(names.size())];
+                out += " = ";
+                expression(out, options.terms, 0);
+                break;
+            case Shape::COMMENTS:
+                for (int lines = 1 + pick(3); lines > 0; lines--) {
+                    comment(out, 1);
+                }
+                statement(out, pick(3), 1);
+                break;
+            case Shape::CONTROL:
+                statement(out, 1 + pick(3), 1);
+                break;
+            default:
+                statement(out, pick(4) == 0 ? 1 + pick(2) : 0, 1);
+                break;
+        }
+        out += ";\n";
+    }
+
+    out += "end.\n";
+    return out;
+}
+
+
+/*
+    @brief gets the name of a shape
+    @param shape the shape
+    @return its name
+*/
+const char* ProgramGenerator::shapeName(Shape shape)
+{
+    return SHAPE_NAMES[static_cast<size_t>(shape)];
+}
+
+
+/*
+    @brief looks a shape up by name
+    @param(s) name the shape's name
+              shape receives the shape
+    @return true if the name is known
+*/
+bool ProgramGenerator::parseShape(const std::string& name, Shape& shape)
+{
+    for (size_t i = 0; i < static_cast<size_t>(Shape::COUNT); i++) {
+        if (name == SHAPE_NAMES[i]) {
+            shape = static_cast<Shape>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+    @brief draws a random number
+    @param count how many values to choose from
+    @return a number in [0, count)
+*/
+int ProgramGenerator::pick(int count)
+{
+    return static_cast<int>(random() % static_cast<uint32_t>(count));
+}
+
+
+/*
+    @brief declares more variables
+    @param(s) out the program so far
+              count how many variables
+              perLine how many share one var declaration
+    @return N/A
+*/
+void ProgramGenerator::declare(std::string& out, size_t count, size_t perLine)
+{
+    const size_t prefixes = sizeof(PREFIXES) / sizeof(PREFIXES[0]);
+    for (size_t i = 0; i < count; i++) {
+        size_t index = names.size();
+        names.push_back(PREFIXES[index % prefixes] + std::to_string(index / prefixes));
+        out += (i % perLine == 0) ? "  var " : ", ";
+        out += names.back();
+        if (i % perLine == perLine - 1 || i == count - 1) {
+            out += ";\n";
+        }
+    }
+}
+
+
+/*
+    @brief writes one statement, without the ';' after it. Nesting is
+           written with loops, so any depth can be generated
+    @param(s) out the program so far
+              nesting how many if or while statements to nest it in
+              indent its indentation level
+    @return N/A
+*/
+void ProgramGenerator::statement(std::string& out, int nesting, int indent)
+{
+    for (; nesting > 0; nesting--, indent++) {
+        out.append(2 * std::min(indent, MAX_INDENT), ' ');
+        out += (options.runnable || pick(2)) ? "if (" : "while (";
+        if (options.shape == Shape::NESTING) {
+            expression(out, 2, 1 + pick(3));
+        } else {
+            expression(out, 1 + pick(3), 0);
+        }
+        out += ")\n";
+    }
+
+    out.append(2 * std::min(indent, MAX_INDENT), ' ');
+    out += names[pick(names.size())];
+    out += " = ";
+    if (options.shape == Shape::NESTING) {
+        expression(out, 3, options.depth);
+    } else {
+        expression(out, 1 + pick(6), 0);
+    }
+}
+
+
+/*
+    @brief writes an expression
+    @param(s) out the program so far
+              terms how many operands
+              nesting how many parentheses to wrap it in
+    @return N/A
+*/
+void ProgramGenerator::expression(std::string& out, int terms, int nesting)
+{
+    out.append(nesting, '(');
+    for (int i = 0; i < terms; i++) {
+        if (i > 0) {
+            out += (i % 16 == 0) ? "\n        " : " ";
+            char op = OPERATORS[pick(4)];
+            out += op;
+            out += " ";
+            if (op == '/' && options.runnable) {
+                divisor(out);
+                continue;
+            }
+        }
+        if (terms > 4 && pick(8) == 0) {
+            out += "(";
+            operand(out);
+            out += " ";
+            char op = OPERATORS[pick(4)];
+            out += op;
+            out += " ";
+            if (op == '/' && options.runnable) {
+                divisor(out);
+            } else {
+                operand(out);
+            }
+            out += ")";
+        } else {
+            operand(out);
+        }
+    }
+    for (; nesting > 0; nesting--) {
+        out += pick(2) ? ") * " : ") - ";
+        operand(out);
+    }
+}
+
+
+/*
+    @brief writes a variable or a number
+    @param out the program so far
+    @return N/A
+*/
+void ProgramGenerator::operand(std::string& out)
+{
+    if (pick(3) == 0) {
+        out += std::to_string(pick(1000));
+    } else {
+        out += names[pick(names.size())];
+    }
+}
+
+
+/*
+    @brief writes a number that is never 0, to divide by
+    @param out the program so far
+    @return N/A
+*/
+void ProgramGenerator::divisor(std::string& out)
+{
+    out += std::to_string(1 + pick(999));
+}
+
+
+/*
+    @brief writes a comment line
+    @param(s) out the program so far
+              indent its indentation level
+    @return N/A
+*/
+void ProgramGenerator::comment(std::string& out, int indent)
+{
+    const int words = sizeof(WORDS) / sizeof(WORDS[0]);
+    out.append(2 * indent, ' ');
+    out += "~";
+    for (int count = 6 + pick(10); count > 0; count--) {
+        out += " ";
+        out += WORDS[pick(words)];
+    }
+    out += "\n";
+}
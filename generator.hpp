@@ -0,0 +1,65 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: generator.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the synthetic program generator used by
+ *         the benchmarks. It writes legal programs of any size in one
+ *         of several shapes, each stressing a different part of the
+ *         compiler:
+ *           mixed          assignments, ifs and whiles in proportion
+ *           declarations   mostly var declarations
+ *           nesting        deeply nested statements and parentheses
+ *           expressions    long expressions
+ *           comments       more comment text than code
+ *           control        mostly if and while statements
+ *         The same options and seed always produce the same program.
+ *         A runnable program has only ifs, and divides only by
+ *         nonzero constants, so it always runs to completion.
+ ***************************************************************/
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+class ProgramGenerator {
+
+public:
+    enum class Shape { MIXED, DECLARATIONS, NESTING, EXPRESSIONS, COMMENTS, CONTROL, COUNT };
+
+    struct Options {
+        Shape shape = Shape::MIXED;
+        size_t bytes = 1 << 20;      // the program ends soon after this size
+        int variables = 64;          // declared variables, except for declarations
+        int depth = 24;              // nesting depth of the nesting shape
+        int terms = 64;              // operands per expression of the expressions shape
+        uint32_t seed = 1;
+        bool runnable = false;       // no loops and no division by a variable, so the VM runs it to the end
+    };
+
+    explicit ProgramGenerator(const Options& options);
+    std::string generate();
+
+    static const char* shapeName(Shape shape);
+    static bool parseShape(const std::string& name, Shape& shape);
+
+private:
+    Options options;
+    std::mt19937 random;
+    std::vector<std::string> names;      // declared variables
+
+    int pick(int count);
+    void declare(std::string& out, size_t count, size_t perLine);
+    void statement(std::string& out, int nesting, int indent);
+    void expression(std::string& out, int terms, int nesting);
+    void operand(std::string& out);
+    void divisor(std::string& out);
+    void comment(std::string& out, int indent);
+};
+
+#endif
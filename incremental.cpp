@@ -0,0 +1,382 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: incremental.cpp
+ *  Project 2
+ *
+ *  @brief Contains the incremental compiler: applying edits to the
+ *         source, re-parsing the statements they touch and splicing
+ *         the new statements' IR in with the IR that is still valid
+ ***************************************************************/
+
+#include "incremental.hpp"
+#include "parser.hpp"
+#include "scanner.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+// how many bytes "end." spans; the text after it is never scanned
+static constexpr size_t END_LENGTH = 4;
+
+/*
+    @brief Parameterized constructor
+    @param name the program's name in messages
+    @return N/A
+*/
+IncrementalCompiler::IncrementalCompiler(const std::string& name) : name(name)
+{
+    text.push_back(Scanner::EOI);
+}
+
+
+/*
+    @brief replaces the source and compiles all of it
+    @param source the program, without the EOI sentinel
+    @return true if the program is legal
+*/
+bool IncrementalCompiler::load(std::string_view source)
+{
+    text.assign(source.data(), source.size());
+    text.push_back(Scanner::EOI);
+    return rebuild();
+}
+
+
+/*
+    @brief replaces erased bytes at offset with inserted and brings the
+           IR up to date with the new source
+    @param(s) offset where the edit starts
+              erased how many bytes it removes; clipped to the source
+              inserted what it puts in their place
+    @return true if the edited program is legal
+*/
+bool IncrementalCompiler::edit(size_t offset, size_t erased, std::string_view inserted)
+{
+    size_t length = text.size() - 1;
+    offset = std::min(offset, length);
+    erased = std::min(erased, length - offset);
+    size_t erasedEnd = offset + erased;
+    long delta = static_cast<long>(inserted.size()) - static_cast<long>(erased);
+
+    text.replace(offset, erased, inserted.data(), inserted.size());
+    linkedValid = false;
+
+    // positions after the erased bytes move with the edit; positions
+    // inside them collapse to its start, where they are re-parsed
+    auto shift = [&](size_t& position) {
+        if (position >= erasedEnd) {
+            position += delta;
+        } else if (position > offset) {
+            position = offset;
+        }
+    };
+    auto after = std::lower_bound(statements.begin(), statements.end(), offset,
+                                  [](const Statement& statement, size_t at) { return statement.start < at; });
+    for (auto it = after; it != statements.end(); ++it) {
+        shift(it->start);
+    }
+    shift(endStart);
+
+    if (dirty) {
+        shift(dirtyFrom);
+        shift(dirtyTo);
+        dirtyFrom = std::min(dirtyFrom, offset);
+        dirtyTo = std::max(dirtyTo, offset + inserted.size());
+    } else {
+        dirtyFrom = offset;
+        dirtyTo = offset + inserted.size();
+        dirty = true;
+    }
+
+    if (dirtyFrom > endStart + END_LENGTH) {
+        // only the text after "end." changed, which is never read
+        stats = EditStats();
+        dirty = false;
+        return true;
+    }
+
+    // the first statement whose source runs up to or past the edit;
+    // its end is the next statement's start
+    auto next = std::lower_bound(statements.begin() + std::min<size_t>(statements.size(), 1), statements.end(),
+                                 dirtyFrom, [](const Statement& statement, size_t at) { return statement.start < at; });
+    size_t first = static_cast<size_t>(next - statements.begin());
+
+    // the declarations end where the first statement starts, so an edit
+    // up to the end of that statement may move them
+    if (first <= 1) {
+        return rebuild();
+    }
+    return reparse(first - 1);
+}
+
+
+/*
+    @brief checks whether the program, as of the last edit, is legal
+    @return true if it is
+*/
+bool IncrementalCompiler::legal() const
+{
+    return !dirty;
+}
+
+
+/*
+    @brief gets the messages a full compile of the current source prints
+    @return the messages, "Compiling <name>..." first
+*/
+const std::string& IncrementalCompiler::log() const
+{
+    return messages;
+}
+
+
+/*
+    @brief gets the current source
+    @return the source, without the EOI sentinel
+*/
+std::string_view IncrementalCompiler::source() const
+{
+    return std::string_view(text.data(), text.size() - 1);
+}
+
+
+/*
+    @brief gets the number of top-level statements known to be parsed
+    @return the count
+*/
+size_t IncrementalCompiler::statementCount() const
+{
+    return statements.size();
+}
+
+
+/*
+    @brief reports how much the last load() or edit() re-did
+    @return the counts
+*/
+const IncrementalCompiler::EditStats& IncrementalCompiler::lastEdit() const
+{
+    return stats;
+}
+
+
+/*
+    @brief gets the IR of the whole program, identical to what a full
+           compile generates. Each statement's labels are rebased and
+           undeclared variables are numbered in order of their first
+           STORE, as the Parser would. Only meaningful while legal()
+    @return the IR, valid until the next edit
+*/
+const IRProgram& IncrementalCompiler::program()
+{
+    if (linkedValid) {
+        return linked;
+    }
+
+    linked = IRProgram();
+    std::vector<int32_t> slots(symbols.symbolCount(), -1);
+    for (int32_t slot = 0; slot < declared; slot++) {
+        slots[slot] = linked.intern(symbols.symbolName(slot));
+    }
+
+    size_t total = 0;
+    for (const Statement& statement : statements) {
+        total += statement.code.size();
+    }
+    linked.code.reserve(total);
+
+    int32_t base = 0;
+    for (const Statement& statement : statements) {
+        for (Instr instr : statement.code) {
+            switch (instr.op) {
+                case Op::BZ:
+                case Op::BR:
+                case Op::LABEL:
+                    instr.arg += base;
+                    break;
+                case Op::EVAL:
+                case Op::STORE:
+                    if (slots[instr.arg] < 0) {
+                        slots[instr.arg] = linked.intern(symbols.symbolName(instr.arg));
+                    }
+                    instr.arg = slots[instr.arg];
+                    break;
+                default:
+                    break;
+            }
+            linked.code.push_back(instr);
+        }
+        base += statement.labels;
+    }
+
+    linkedValid = true;
+    return linked;
+}
+
+
+/*
+    @brief compiles the whole source from scratch. If it is illegal,
+           the statements parsed before the error are kept and the rest
+           of the source is left dirty
+    @return true if the program is legal
+*/
+bool IncrementalCompiler::rebuild()
+{
+    std::ostringstream log;
+    Scanner scanner(text.data(), text.size());
+    scanner.setOutput(log);
+    Parser parser(scanner, log, log);
+
+    // the Parser scans the first token before "Compiling <name>..."
+    std::string early = log.str();
+    log.str("");
+
+    statements.clear();
+    declared = 0;
+    endStart = text.size() - 1;
+    linkedValid = false;
+    stats = EditStats();
+    stats.full = true;
+
+    std::vector<Statement> parsed;
+    bool ok = false;
+    try {
+        parser.expect(TokenKind::beginSym);
+        parser.VarDeclarations();
+        declared = parser.declared;
+        parseStatements(parser, 0, std::numeric_limits<size_t>::max(), parsed);
+        ok = true;
+    } catch (const CompileError&) {
+        // already reported by Parser::error()
+    } catch (const std::exception& e) {
+        log << "parsing error: " << e.what() << std::endl;
+    }
+
+    stats.reparsed = parsed.size();
+    stats.relexed = scanner.getOffset();
+    dirtyFrom = 0;
+    dirtyTo = text.size() - 1;
+    if (!ok && !parsed.empty()) {
+        // the last statement is the one that failed
+        dirtyFrom = parsed.back().start;
+        parsed.pop_back();
+    }
+    statements = std::move(parsed);
+    symbols = std::move(parser.IR);
+    symbols.code.clear();
+
+    finish(ok, log.str());
+    messages.insert(0, early);
+    return ok;
+}
+
+
+/*
+    @brief re-parses from the start of a statement through the dirty
+           range and swaps the new statements in for the old ones
+    @param first index of the statement to start at
+    @return true if the program is legal
+*/
+bool IncrementalCompiler::reparse(size_t first)
+{
+    size_t start = statements[first].start;
+    std::ostringstream log;
+    Scanner scanner(text.data(), text.size());
+    scanner.setOutput(log);
+    scanner.seek(start);
+    Parser parser(scanner, log, log);
+    parser.IR = std::move(symbols);
+    parser.declared = declared;
+
+    stats = EditStats();
+    std::vector<Statement> parsed;
+    bool ok = false;
+    try {
+        size_t resume = parseStatements(parser, first, dirtyTo, parsed);
+        if (parsed.size() == resume - first) {
+            std::move(parsed.begin(), parsed.end(), statements.begin() + first);
+        } else {
+            statements.erase(statements.begin() + first, statements.begin() + resume);
+            statements.insert(statements.begin() + first,
+                              std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+        }
+        ok = true;
+    } catch (const CompileError&) {
+        // already reported by Parser::error(); the old statements stay
+        // until a later edit makes the dirty range parse
+    } catch (const std::exception& e) {
+        log << "parsing error: " << e.what() << std::endl;
+    }
+
+    stats.reparsed = parsed.size();
+    stats.relexed = scanner.getOffset() - start;
+    symbols = std::move(parser.IR);
+    symbols.code.clear();
+
+    finish(ok, log.str());
+    return ok;
+}
+
+
+/*
+    @brief parses top-level statements until "end." or, once past
+           resumeFrom, until the start of an old statement. Each
+           statement's IR is moved out of the parser with its labels
+           numbered from 0. Throws as the Parser does on an error, with
+           the failing statement last in parsed
+    @param(s) parser positioned at a statement's first token
+              first old statements before this index are not resumed at
+              resumeFrom offset the resumed statement must start after
+              parsed receives the statements
+    @return index of the old statement parsing resumed at, or the
+            statement count if it reached "end."
+*/
+size_t IncrementalCompiler::parseStatements(Parser& parser, size_t first, size_t resumeFrom,
+                                            std::vector<Statement>& parsed)
+{
+    Scanner& scanner = parser.scanner;
+    while (true) {
+        size_t at = scanner.getTokenOffset();
+        if (parser.lookahead.type == TokenKind::endSym) {
+            endStart = at;
+            return statements.size();
+        }
+        if (at > resumeFrom) {
+            auto found = std::lower_bound(statements.begin() + first, statements.end(), at,
+                                          [](const Statement& statement, size_t offset) { return statement.start < offset; });
+            if (found != statements.end() && found->start == at) {
+                return static_cast<size_t>(found - statements.begin());
+            }
+        }
+
+        parsed.push_back({at, 0, {}});
+        parser.Stmt();
+        if (parser.lookahead.type == TokenKind::semicolon) {
+            parser.expect(TokenKind::semicolon);
+        }
+
+        Statement& statement = parsed.back();
+        statement.code = parser.IR.code;
+        statement.labels = parser.lastLabel + 1;
+        parser.IR.code.clear();
+        parser.lastLabel = -1;
+    }
+}
+
+
+/*
+    @brief records the outcome of a parse as the messages a full
+           compile prints
+    @param(s) ok whether the program is legal
+              output what the parse reported
+    @return N/A
+*/
+void IncrementalCompiler::finish(bool ok, const std::string& output)
+{
+    messages = "Compiling " + name + "...\n" + output;
+    if (ok) {
+        messages += "Success! The program is legal!\n";
+    }
+    dirty = !ok;
+}
@@ -0,0 +1,91 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: incremental.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the incremental compiler, which keeps a
+ *         program's source and generated IR between small edits and
+ *         only re-lexes and re-parses the statements an edit touches.
+ *
+ *         The IR of every top-level statement (a Stmt and the ';'
+ *         after it, if any) is kept on its own, with labels numbered
+ *         from 0 within the statement. An edit re-parses from the
+ *         start of the statement it lands in, a point where the
+ *         scanner holds no state, until the parse reaches the start of
+ *         an old statement past the edit; from there the source, and
+ *         so the parse, is unchanged. Edits to the declarations, or to
+ *         the first statement where they end, re-parse the whole
+ *         program. program() rebuilds the IR a full compile would
+ *         produce, rebasing each statement's labels.
+ *
+ *         While the program is illegal the edited range stays dirty
+ *         and is re-parsed along with the next edit, so diagnostics
+ *         always match a full compile.
+ ***************************************************************/
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "ir.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Parser;
+
+class IncrementalCompiler {
+
+public:
+    // what the last load() or edit() had to redo
+    struct EditStats {
+        bool full = false;            // the whole program was re-parsed
+        size_t reparsed = 0;          // statements parsed
+        size_t relexed = 0;           // source bytes scanned
+    };
+
+    explicit IncrementalCompiler(const std::string& name);
+
+    bool load(std::string_view source);
+    bool edit(size_t offset, size_t erased, std::string_view inserted);
+
+    bool legal() const;
+    const std::string& log() const;
+    std::string_view source() const;
+    size_t statementCount() const;
+    const EditStats& lastEdit() const;
+    const IRProgram& program();
+
+private:
+    // one top-level statement
+    struct Statement {
+        size_t start;                 // offset of its first token
+        int32_t labels;               // labels it uses, numbered from 0
+        std::vector<Instr> code;      // EVAL/STORE operands are slots in symbols
+    };
+
+    std::string name;                 // used in messages
+    std::string text;                 // the source plus the EOI sentinel
+    IRProgram symbols;                // every variable seen, declared ones first
+    int32_t declared = 0;
+    std::vector<Statement> statements;
+    size_t endStart = 0;              // offset of the "end." token
+
+    bool dirty = true;                // [dirtyFrom, dirtyTo] is not parsed yet
+    size_t dirtyFrom = 0;
+    size_t dirtyTo = 0;
+
+    std::string messages;             // what a full compile prints
+    EditStats stats;
+    IRProgram linked;                 // program(), valid while linkedValid
+    bool linkedValid = false;
+
+    bool rebuild();
+    bool reparse(size_t first);
+    size_t parseStatements(Parser& parser, size_t first, size_t resumeFrom, std::vector<Statement>& parsed);
+    void finish(bool ok, const std::string& output);
+};
+
+#endif
@@ -0,0 +1,263 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: ir.cpp
+ *  Project 2
+ *
+ *  @brief Contains the symbol interning and operand formatting
+ *         of the packed RPN representation
+ ***************************************************************/
+
+#include "ir.hpp"
+
+#include <charconv>
+
+/*
+    @brief hashes a symbol name (32-bit FNV-1a)
+    @param name the symbol name
+    @return the hash
+*/
+static uint32_t hashName(std::string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+
+/*
+    @brief finds the bucket holding a name, or the empty bucket where
+           it would go
+    @param(s) name the symbol name
+              hash its hash
+    @return the bucket index
+*/
+size_t IRProgram::probe(std::string_view name, uint32_t hash) const
+{
+    size_t mask = buckets.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Bucket& bucket = buckets[i];
+        if (bucket.id < 0 || (bucket.hash == hash && names[bucket.id] == name)) {
+            return i;
+        }
+    }
+}
+
+
+/*
+    @brief doubles the hash table and reinserts every name
+    @return N/A
+*/
+void IRProgram::grow()
+{
+    std::vector<Bucket> old = std::move(buckets);
+    buckets.assign(old.empty() ? 64 : old.size() * 2, Bucket{0, -1});
+    for (const Bucket& bucket : old) {
+        if (bucket.id >= 0) {
+            buckets[probe(names[bucket.id], bucket.hash)] = bucket;
+        }
+    }
+}
+
+
+/*
+    @brief gets the id of a symbol name, assigning the next free id
+           the first time a name is seen
+    @param name the symbol name
+    @return the symbol id
+*/
+int32_t IRProgram::intern(std::string_view name)
+{
+    // keep the table at most half full
+    if (2 * (names.size() + 1) > buckets.size()) {
+        grow();
+    }
+    uint32_t hash = hashName(name);
+    Bucket& bucket = buckets[probe(name, hash)];
+    if (bucket.id < 0) {
+        bucket = Bucket{hash, static_cast<int32_t>(names.size())};
+        names.emplace_back(name);
+    }
+    return bucket.id;
+}
+
+
+/*
+    @brief finds the id of a symbol name without adding it
+    @param name the symbol name
+    @return the symbol id, -1 if the name was never interned
+*/
+int32_t IRProgram::lookup(std::string_view name) const
+{
+    if (buckets.empty()) {
+        return -1;
+    }
+    return buckets[probe(name, hashName(name))].id;
+}
+
+
+/*
+    @brief gets the name of an interned symbol
+    @param id the symbol id
+    @return the symbol name
+*/
+const std::string& IRProgram::symbolName(int32_t id) const
+{
+    return names[static_cast<size_t>(id)];
+}
+
+
+/*
+    @brief gets the number of interned symbols
+    @return the symbol count
+*/
+size_t IRProgram::symbolCount() const
+{
+    return names.size();
+}
+
+
+/*
+    @brief checks if an operation carries an operand
+    @param op the operation
+    @return true for PUSH, EVAL, STORE, BZ, BR and LABEL
+*/
+bool IRProgram::hasOperand(Op op)
+{
+    switch (op) {
+        case Op::PLUS:
+        case Op::MINUS:
+        case Op::TIMES:
+        case Op::DIV:
+            return false;
+        default:
+            return true;
+    }
+}
+
+
+/*
+    @brief formats an instruction's operand as it appears in RPN text:
+           the constant, the symbol name, the label "Ln" or, linked,
+           the target's instruction index
+    @param instr the instruction
+    @return the operand text, empty if the operation has none
+*/
+std::string IRProgram::operandText(const Instr& instr) const
+{
+    switch (instr.op) {
+        case Op::PUSH:
+            return std::to_string(instr.arg);
+        case Op::EVAL:
+        case Op::STORE:
+            return symbolName(instr.arg);
+        case Op::BZ:
+        case Op::BR:
+            return (linked ? "" : "L") + std::to_string(instr.arg);
+        case Op::LABEL:
+            return "L" + std::to_string(instr.arg);
+        default:
+            return "";
+    }
+}
+
+
+/*
+    @brief parses RPN text, in either the default ['OP, 'arg'] format
+           or the compact "OP arg" format, replacing this program's
+           code. Symbols already interned keep their slots, so a symbol
+           table interned first survives, unused names included.
+           Branches to bare instruction indexes make it a linked
+           program, which may not also have labels
+    @param(s) text the RPN text
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool IRProgram::parseText(std::string_view text, std::string& errorMsg)
+{
+    code.clear();
+    linked = false;
+    size_t lineNumber = 0;
+    bool labelled = false;
+
+    while (!text.empty()) {
+        size_t newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        // strip the text format's ['...'] wrapping and quotes
+        std::string_view name;
+        std::string_view operand;
+        if (line.size() >= 4 && line.substr(0, 2) == "['" && line.substr(line.size() - 2) == "']") {
+            line = line.substr(2, line.size() - 4);
+            size_t comma = line.find(", '");
+            name = line.substr(0, comma);
+            if (comma != std::string_view::npos) {
+                operand = line.substr(comma + 3);
+            }
+        } else {
+            size_t space = line.find(' ');
+            name = line.substr(0, space);
+            if (space != std::string_view::npos) {
+                operand = line.substr(space + 1);
+            }
+        }
+
+        size_t op = 0;
+        while (op < static_cast<size_t>(Op::COUNT) && name != OP_NAMES[op]) {
+            op++;
+        }
+        if (op == static_cast<size_t>(Op::COUNT) || hasOperand(static_cast<Op>(op)) == operand.empty()) {
+            errorMsg = "Invalid RPN at line " + std::to_string(lineNumber);
+            return false;
+        }
+
+        Instr instr{static_cast<Op>(op), 0};
+        bool ok = true;
+        switch (instr.op) {
+            case Op::PUSH: {
+                auto result = std::from_chars(operand.data(), operand.data() + operand.size(), instr.arg);
+                ok = result.ec == std::errc() && result.ptr == operand.data() + operand.size();
+                break;
+            }
+            case Op::EVAL:
+            case Op::STORE:
+                instr.arg = intern(operand);
+                break;
+            case Op::BZ:
+            case Op::BR:
+            case Op::LABEL: {
+                bool label = operand[0] == 'L';
+                ok = instr.op != Op::LABEL || label;
+                if (ok) {
+                    const char* digits = operand.data() + (label ? 1 : 0);
+                    auto result = std::from_chars(digits, operand.data() + operand.size(), instr.arg);
+                    ok = result.ec == std::errc() && result.ptr == operand.data() + operand.size() && instr.arg >= 0;
+                }
+                labelled = labelled || label;
+                linked = linked || !label;
+                if (ok && labelled && linked) {
+                    errorMsg = "Labels in linked RPN at line " + std::to_string(lineNumber);
+                    return false;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        if (!ok) {
+            errorMsg = "Invalid operand at line " + std::to_string(lineNumber);
+            return false;
+        }
+        code.push_back(instr);
+    }
+    return true;
+}
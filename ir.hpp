@@ -0,0 +1,95 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: ir.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the packed intermediate representation
+ *         of the RPN stream: one-byte opcodes with a 32-bit operand
+ *         held in a contiguous buffer, plus the symbol names that
+ *         EVAL/STORE operands refer to by dense slot number.
+ *
+ *         Branches name labels until the program is linked; after
+ *         linkIR() there are no LABELs and a branch operand is the
+ *         index of the instruction it jumps to, the instruction count
+ *         meaning the end of the program.
+ ***************************************************************/
+
+#ifndef IR_H
+#define IR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// RPN operations
+enum class Op : uint8_t {
+    PUSH,       // operand: integer constant
+    EVAL,       // operand: symbol id
+    STORE,      // operand: symbol id
+    PLUS,
+    MINUS,
+    TIMES,
+    DIV,
+    BZ,         // operand: label number, or instruction index once linked
+    BR,         // operand: label number, or instruction index once linked
+    LABEL,      // operand: label number
+    COUNT
+};
+
+// printable operation names
+inline constexpr const char* OP_NAMES[] = {
+    "PUSH", "EVAL", "STORE", "PLUS", "MINUS", "TIMES", "DIV", "BZ", "BR", "LABEL"
+};
+
+static_assert(sizeof(OP_NAMES) / sizeof(OP_NAMES[0]) == static_cast<size_t>(Op::COUNT),
+              "every Op needs a name");
+
+// one RPN instruction
+struct Instr {
+    Op op;
+    int32_t arg;
+};
+
+static_assert(sizeof(Instr) == 8, "Instr should stay packed");
+
+class IRProgram {
+
+public:
+    std::vector<Instr> code;
+    bool linked = false;        // branch operands are instruction indexes
+
+    /*
+        @brief appends one instruction
+        @param(s) op the operation
+                  arg its operand, 0 if it has none
+        @return N/A
+    */
+    void emit(Op op, int32_t arg = 0) {
+        code.push_back({op, arg});
+    }
+
+    int32_t intern(std::string_view name);
+    int32_t lookup(std::string_view name) const;
+    const std::string& symbolName(int32_t id) const;
+    size_t symbolCount() const;
+    static bool hasOperand(Op op);
+    std::string operandText(const Instr& instr) const;
+    bool parseText(std::string_view text, std::string& errorMsg);
+
+private:
+    // one bucket of the name -> slot hash table; id -1 is empty
+    struct Bucket {
+        uint32_t hash;
+        int32_t id;
+    };
+
+    std::vector<std::string> names;     // slot -> name
+    std::vector<Bucket> buckets;        // open addressing, power of two size
+
+    size_t probe(std::string_view name, uint32_t hash) const;
+    void grow();
+};
+
+#endif
@@ -0,0 +1,138 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: linker.cpp
+ *  Project 2
+ *
+ *  @brief Contains the label resolution and jump threading of the
+ *         linking pass
+ ***************************************************************/
+
+#include "linker.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+/*
+    @brief sends every BR that lands on another BR to the end of the
+           chain. A chain that runs into a cycle of BRs, an endless
+           loop, ends at the first BR of the cycle
+    @param code linked instructions, rewritten in place
+    @return the number of BRs retargeted
+*/
+static size_t threadJumps(std::vector<Instr>& code)
+{
+    enum : uint8_t { UNSEEN, ON_PATH, DONE };
+    std::vector<uint8_t> state(code.size(), UNSEEN);
+    std::vector<size_t> path;
+    size_t threaded = 0;
+
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i].op != Op::BR || state[i] != UNSEEN) {
+            continue;
+        }
+        // follow the chain until it leaves the BRs or meets a known one
+        size_t at = i;
+        path.clear();
+        while (at < code.size() && code[at].op == Op::BR && state[at] == UNSEEN) {
+            state[at] = ON_PATH;
+            path.push_back(at);
+            at = static_cast<size_t>(code[at].arg);
+        }
+        // a BR already threaded goes where it goes; a cycle is left as
+        // it is and the BRs leading into it jump to its first BR
+        size_t cycle = path.size();
+        int32_t end = static_cast<int32_t>(at);
+        if (at < code.size() && code[at].op == Op::BR) {
+            if (state[at] == DONE) {
+                end = code[at].arg;
+            } else {
+                cycle = 0;
+                while (path[cycle] != at) {
+                    cycle++;
+                }
+            }
+        }
+        for (size_t p = 0; p < path.size(); p++) {
+            if (p < cycle && code[path[p]].arg != end) {
+                code[path[p]].arg = end;
+                threaded++;
+            }
+            state[path[p]] = DONE;
+        }
+    }
+    return threaded;
+}
+
+
+/*
+    @brief links a program in place: drops its LABELs, resolves each
+           branch to an instruction index, where one past the last
+           instruction is the end of the program, and threads jumps
+           through BRs. A linked program is left as it is
+    @param(s) program the program to link
+              stats receives what was done
+              errorMsg receives the reason on failure
+    @return true on success, false if a branch names a label that is
+            never placed, leaving the program unchanged
+*/
+bool linkIR(IRProgram& program, LinkStats& stats, std::string& errorMsg)
+{
+    stats = LinkStats();
+    if (program.linked) {
+        return true;
+    }
+    std::vector<Instr>& code = program.code;
+
+    // where each label lands once LABELs are removed
+    std::vector<int32_t> target;
+    int32_t placed = 0;
+    for (const Instr& instr : code) {
+        if (instr.op == Op::LABEL) {
+            if (instr.arg < 0) {
+                errorMsg = "Invalid label L" + std::to_string(instr.arg);
+                return false;
+            }
+            if (target.size() <= static_cast<size_t>(instr.arg)) {
+                target.resize(instr.arg + 1, -1);
+            }
+            target[instr.arg] = placed;
+            stats.labels++;
+        } else {
+            placed++;
+        }
+    }
+    for (const Instr& instr : code) {
+        if ((instr.op == Op::BZ || instr.op == Op::BR)
+            && (instr.arg < 0 || static_cast<size_t>(instr.arg) >= target.size() || target[instr.arg] < 0)) {
+            errorMsg = "Branch to undefined label L" + std::to_string(instr.arg);
+            return false;
+        }
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        Instr instr = code[i];
+        if (instr.op == Op::LABEL) {
+            continue;
+        }
+        if (instr.op == Op::BZ || instr.op == Op::BR) {
+            instr.arg = target[instr.arg];
+            stats.branches++;
+        }
+        code[n++] = instr;
+    }
+    code.resize(n);
+
+    // BRs first, so a BZ needs only one step past the BR it lands on
+    stats.threaded = threadJumps(code);
+    for (Instr& instr : code) {
+        size_t to = static_cast<size_t>(instr.arg);
+        if (instr.op == Op::BZ && to < code.size() && code[to].op == Op::BR) {
+            instr.arg = code[to].arg;
+            stats.threaded++;
+        }
+    }
+    program.linked = true;
+    return true;
+}
@@ -0,0 +1,31 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: linker.hpp
+ *  Project 2
+ *
+ *  @brief This file declares the linking pass run over the RPN
+ *         after optimization: LABEL pseudo-instructions are removed,
+ *         every BZ/BR operand becomes the index of the instruction
+ *         it jumps to, and jumps that land on a BR are sent straight
+ *         to where that BR goes. Loaders of a linked program need no
+ *         label table.
+ ***************************************************************/
+
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "ir.hpp"
+
+#include <cstddef>
+#include <string>
+
+// what linkIR() did
+struct LinkStats {
+    size_t labels = 0;          // LABELs removed
+    size_t branches = 0;        // BZ/BR operands resolved
+    size_t threaded = 0;        // of those, sent past a BR they landed on
+};
+
+bool linkIR(IRProgram& program, LinkStats& stats, std::string& errorMsg);
+
+#endif
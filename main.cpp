@@ -3,41 +3,279 @@
   File Name: main.cpp
   Project 2
 
-  @brief Contains the main function for the scanner, 
-         recursive descent and generates RPN code for 
+  @brief Contains the main function for the scanner,
+         recursive descent and generates RPN code for
          successfully parsed input files
 ***************************************************************/
 
-#include "parser.hpp"
-#include "scanner.hpp"
+#include "driver.hpp"
+#include "server.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+/*
+    @brief prints how to run the program
+    @param program the name it was run as
+    @return N/A
+*/
+static void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--io=mmap|read|stream] [--chunk=BYTES] [--format=text|compact] [--emit=text|bytecode|both] [--stats[=text|json]] [--stats-out=PATH] [--pretokenize] [--lex-threads=N] [--parse-threads=N] [-O0|-O1] [--link] [--backend=stack|register] [--registers=N] [--run] [--limit=N] [--cache=DIR] [--cache-size=MB] [-j N] <source_file | - | @list | dir>..." << std::endl;
+    std::cerr << "       " << program << " --exec [--backend=stack|register] [--registers=N] [--limit=N] <rpn_file>..." << std::endl;
+    std::cerr << "       " << program << " --server[=SOCKET] [--format=text|compact] [-O0|-O1]" << std::endl;
+}
+
+
+/*
+    @brief checks that an argument is a count written in decimal digits
+    @param text the argument
+    @return true if it is non-empty and all digits
+*/
+static bool isCount(const std::string& text)
+{
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+
+/*
+    @brief reads the count an option was given
+    @param(s) text the option's value
+              value receives the count
+              max the largest count allowed
+    @return true if text is all digits and the count fits in max
+*/
+static bool parseCount(const std::string& text, uint64_t& value, uint64_t max)
+{
+    return isCount(text) && std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc()
+           && value <= max;
+}
 
 
 int main(int argc, char* argv[]) {
-    
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <source_file>" << std::endl;
-        return 1;  
+
+    CompileOptions options;
+    std::vector<std::string> inputs;
+    unsigned jobs = 0;
+    bool batch = false;
+    bool exec = false;
+    bool server = false;
+    std::string socketPath;
+    std::string cacheDir;
+    uint64_t cacheMegabytes = 256;
+    bool statsJSON = false;
+    std::string statsPath;
+    bool registerBackend = false;
+    unsigned registers = RegisterProgram::DEFAULT_REGISTERS;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string errorMsg;
+        if (arg.rfind("--io=", 0) == 0) {
+            if (!SourceFile::parseMode(arg.substr(5), options.io)) {
+                std::cerr << "Error: Unknown input mode " << arg.substr(5) << " (expected mmap, read or stream)" << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--chunk=", 0) == 0) {
+            uint64_t chunk;
+            if (!parseCount(arg.substr(8), chunk, SIZE_MAX) || chunk == 0) {
+                std::cerr << "Error: --chunk expects a positive byte count" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.chunkSize = static_cast<size_t>(chunk);
+        } else if (arg.rfind("--format=", 0) == 0) {
+            if (!RPNWriter::parseFormat(arg.substr(9), options.output.format)) {
+                std::cerr << "Error: Unknown output format " << arg.substr(9) << " (expected text or compact)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--stats" || arg.rfind("--stats=", 0) == 0) {
+            std::string format = arg.size() > 8 ? arg.substr(8) : "text";
+            if (format != "text" && format != "json") {
+                std::cerr << "Error: Unknown stats format " << format << " (expected text or json)" << std::endl;
+                return 1;
+            }
+            options.output.stats = true;
+            statsJSON = (format == "json");
+        } else if (arg.rfind("--stats-out=", 0) == 0) {
+            statsPath = arg.substr(12);
+        } else if (arg.rfind("--emit=", 0) == 0) {
+            std::string emit = arg.substr(7);
+            if (emit != "text" && emit != "bytecode" && emit != "both") {
+                std::cerr << "Error: Unknown output " << emit << " (expected text, bytecode or both)" << std::endl;
+                return 1;
+            }
+            options.output.text = (emit != "bytecode");
+            options.output.bytecode = (emit != "text");
+        } else if (arg == "-O0" || arg == "-O1") {
+            options.output.optimize = arg[2] - '0';
+        } else if (arg == "--link") {
+            options.output.link = true;
+        } else if (arg.rfind("--backend=", 0) == 0) {
+            std::string backend = arg.substr(10);
+            if (backend != "stack" && backend != "register") {
+                std::cerr << "Error: Unknown backend " << backend << " (expected stack or register)" << std::endl;
+                return 1;
+            }
+            registerBackend = (backend == "register");
+        } else if (arg.rfind("--registers=", 0) == 0) {
+            uint64_t count;
+            if (!parseCount(arg.substr(12), count, UINT_MAX) || count == 0) {
+                std::cerr << "Error: --registers expects a positive register count" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            registers = static_cast<unsigned>(count);
+            registerBackend = true;
+        } else if (arg == "--pretokenize") {
+            options.pretokenize = true;
+        } else if (arg.rfind("--lex-threads=", 0) == 0) {
+            uint64_t threads;
+            if (!parseCount(arg.substr(14), threads, UINT_MAX) || threads == 0) {
+                std::cerr << "Error: --lex-threads expects a positive thread count" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.lexThreads = static_cast<unsigned>(threads);
+            options.pretokenize = true;
+        } else if (arg.rfind("--parse-threads=", 0) == 0) {
+            uint64_t threads;
+            if (!parseCount(arg.substr(16), threads, UINT_MAX) || threads == 0) {
+                std::cerr << "Error: --parse-threads expects a positive thread count" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.parseThreads = static_cast<unsigned>(threads);
+            options.pretokenize = true;
+        } else if (arg == "--run") {
+            options.run = true;
+        } else if (arg == "--server" || arg.rfind("--server=", 0) == 0) {
+            server = true;
+            socketPath = arg.size() > 9 ? arg.substr(9) : "";
+        } else if (arg.rfind("--cache=", 0) == 0) {
+            cacheDir = arg.substr(8);
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            // the cap is kept in bytes, so the size in MB must fit once scaled
+            if (!parseCount(arg.substr(13), cacheMegabytes, UINT64_MAX >> 20) || cacheMegabytes == 0) {
+                std::cerr << "Error: --cache-size expects a positive size in MB" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--exec") {
+            exec = true;
+        } else if (arg.rfind("--limit=", 0) == 0) {
+            if (!parseCount(arg.substr(8), options.runLimit, UINT64_MAX)) {
+                std::cerr << "Error: --limit expects an instruction count, 0 for none" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-j" || (arg.rfind("-j", 0) == 0 && isCount(arg.substr(2)))) {
+            std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            uint64_t threads;
+            if (!parseCount(count, threads, UINT_MAX) || threads == 0) {
+                std::cerr << "Error: -j expects a positive thread count" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            jobs = static_cast<unsigned>(threads);
+            batch = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            // "-" alone is standard input; anything else is a typo
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            size_t before = inputs.size();
+            if (!collectInputs(arg, inputs, errorMsg)) {
+                std::cerr << "Error: " << errorMsg << std::endl;
+                return 1;
+            }
+            // lists and directories always compile as a batch
+            if (inputs.size() != before + 1 || inputs.back() != arg) {
+                batch = true;
+            }
+        }
+    }
+
+    options.output.registers = registerBackend ? registers : 0;
+
+    // stay resident and compile requests until told to stop
+    if (server) {
+        CompileServer compileServer(options);
+        return socketPath.empty() ? compileServer.serveStdio() : compileServer.serveSocket(socketPath);
     }
 
-    // Open the source file
-    std::ifstream file(argv[1]);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file " << argv[1] << std::endl;
+    if (inputs.empty()) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    // convert input file into a string
-    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    file.close();  
+    // run saved RPN (text or bytecode) instead of compiling
+    if (exec) {
+        int status = 0;
+        for (const std::string& input : inputs) {
+            if (!execFile(input, options, std::cout, std::cerr)) {
+                status = 1;
+            }
+        }
+        return status;
+    }
 
-    // Create a Scanner instance 
-    Scanner scanner(source);
+    // reuse the outputs of earlier compiles of the same source; streamed
+    // input is never cached
+    std::unique_ptr<CompileCache> cache;
+    if (!cacheDir.empty() && options.io != SourceFile::Mode::STREAM) {
+        std::string errorMsg;
+        cache = std::make_unique<CompileCache>(cacheDir, cacheMegabytes * 1024 * 1024);
+        if (!cache->open(errorMsg)) {
+            std::cerr << "Error: " << errorMsg << std::endl;
+            return 1;
+        }
+        options.cache = cache.get();
+    }
 
-    // Create a Parser instance
-    Parser parser(scanner);
+    // counters and phase times, summed over every file
+    std::unique_ptr<CompileStats> stats;
+    if (options.output.stats) {
+        stats = std::make_unique<CompileStats>();
+    }
+    double start = CompileStats::now();
 
-    // Parse the source code
-    parser.parse(argv[1]);
+    int status;
+    if (!batch && inputs.size() == 1) {
+        status = compileFile(inputs[0], options, std::cout, std::cerr, stats.get()).ok ? 0 : 1;
+    } else {
+        if (jobs == 0) {
+            jobs = std::max(1u, std::thread::hardware_concurrency());
+        }
+        status = runBatch(inputs, jobs, options, stats.get());
+    }
+
+    if (cache) {
+        cache->printStats(std::cout);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    if (stats) {
+        stats->wallSeconds = CompileStats::now() - start;
+        std::ofstream statsFile;
+        if (!statsPath.empty()) {
+            statsFile.open(statsPath);
+            if (!statsFile.is_open()) {
+                std::cerr << "Error: Could not open stats file " << statsPath << std::endl;
+                return 1;
+            }
+        }
+        std::ostream& statsOut = statsPath.empty() ? std::cout : statsFile;
+        if (statsJSON) {
+            stats->printJSON(statsOut);
+        } else {
+            stats->print(statsOut);
+        }
+    }
+    return status;
+}
@@ -0,0 +1,191 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: optimizer.cpp
+ *  Project 2
+ *
+ *  @brief Contains the constant folding, branch folding and dead
+ *         code removal passes over the packed RPN
+ ***************************************************************/
+
+#include "optimizer.hpp"
+
+#include <algorithm>
+#include <vector>
+
+static constexpr size_t NOWHERE = static_cast<size_t>(-1);
+
+/*
+    @brief evaluates a constant operation the way the VM does:
+           32-bit two's complement arithmetic that wraps around
+    @param(s) op PLUS, MINUS, TIMES or DIV
+              a left operand
+              b right operand, never 0 for DIV
+    @return the result
+*/
+static int32_t foldArithmetic(Op op, int32_t a, int32_t b)
+{
+    uint32_t x = static_cast<uint32_t>(a);
+    uint32_t y = static_cast<uint32_t>(b);
+    switch (op) {
+        case Op::PLUS:  return static_cast<int32_t>(x + y);
+        case Op::MINUS: return static_cast<int32_t>(x - y);
+        case Op::TIMES: return static_cast<int32_t>(x * y);
+        default:        return (b == -1) ? static_cast<int32_t>(0u - x) : a / b;
+    }
+}
+
+
+/*
+    @brief replaces arithmetic on two constants by its result, and
+           turns a branch on a constant into an unconditional branch
+           or nothing. A LABEL between the operands keeps them apart,
+           so only straight-line code is folded
+    @param code the instructions, rewritten in place
+    @return true if anything changed
+*/
+static bool foldConstants(std::vector<Instr>& code)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        Instr instr = code[i];
+        switch (instr.op) {
+            case Op::PLUS:
+            case Op::MINUS:
+            case Op::TIMES:
+            case Op::DIV:
+                // a division by zero is left for run time to report
+                if (n >= 2 && code[n - 1].op == Op::PUSH && code[n - 2].op == Op::PUSH
+                    && !(instr.op == Op::DIV && code[n - 1].arg == 0)) {
+                    code[n - 2].arg = foldArithmetic(instr.op, code[n - 2].arg, code[n - 1].arg);
+                    n--;
+                    continue;
+                }
+                break;
+            case Op::BZ:
+                if (n >= 1 && code[n - 1].op == Op::PUSH) {
+                    if (code[n - 1].arg == 0) {
+                        code[n - 1] = Instr{Op::BR, instr.arg};
+                    } else {
+                        n--;
+                    }
+                    continue;
+                }
+                break;
+            default:
+                break;
+        }
+        code[n++] = instr;
+    }
+
+    bool changed = (n != code.size());
+    code.resize(n);
+    return changed;
+}
+
+
+/*
+    @brief removes instructions no path from the start reaches,
+           LABELs no branch refers to, and branches to the very next
+           instruction
+    @param code the instructions, rewritten in place
+    @return true if anything changed
+*/
+static bool removeDeadCode(std::vector<Instr>& code)
+{
+    // where each label is placed
+    std::vector<size_t> where;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i].op == Op::LABEL) {
+            size_t label = static_cast<size_t>(code[i].arg);
+            if (where.size() <= label) {
+                where.resize(label + 1, NOWHERE);
+            }
+            where[label] = i;
+        }
+    }
+    auto target = [&](int32_t label) {
+        size_t l = static_cast<size_t>(label);
+        return l < where.size() ? where[l] : NOWHERE;
+    };
+
+    // flood fill from the first instruction
+    std::vector<uint8_t> live(code.size(), 0);
+    std::vector<size_t> work;
+    std::vector<size_t> uses(where.size(), 0);
+    if (!code.empty()) {
+        work.push_back(0);
+    }
+    while (!work.empty()) {
+        size_t i = work.back();
+        work.pop_back();
+        for (; i < code.size() && !live[i]; i++) {
+            live[i] = 1;
+            if (code[i].op == Op::BZ || code[i].op == Op::BR) {
+                size_t to = target(code[i].arg);
+                if (to != NOWHERE) {
+                    uses[code[i].arg]++;
+                    work.push_back(to);
+                }
+                if (code[i].op == Op::BR) {
+                    break;
+                }
+            }
+        }
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        const Instr& instr = code[i];
+        if (!live[i]) {
+            continue;
+        }
+        if (instr.op == Op::LABEL && uses[instr.arg] == 0) {
+            continue;
+        }
+        if (instr.op == Op::BR && target(instr.arg) != NOWHERE) {
+            // skip the dead code and other labels in between
+            size_t j = i + 1;
+            while (j < code.size() && (!live[j] || (code[j].op == Op::LABEL && code[j].arg != instr.arg))) {
+                j++;
+            }
+            if (j < code.size() && code[j].op == Op::LABEL && code[j].arg == instr.arg) {
+                uses[instr.arg]--;
+                continue;
+            }
+        }
+        code[n++] = instr;
+    }
+
+    // a branch dropped above may have left its label unused
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (code[i].op != Op::LABEL || uses[code[i].arg] != 0) {
+            code[kept++] = code[i];
+        }
+    }
+
+    bool changed = (kept != code.size());
+    code.resize(kept);
+    return changed;
+}
+
+
+/*
+    @brief optimizes a program in place until nothing more changes.
+           It works on labels, so a linked program is left alone
+    @param program the program to optimize
+    @return the number of instructions removed
+*/
+size_t optimizeIR(IRProgram& program)
+{
+    if (program.linked) {
+        return 0;
+    }
+    size_t before = program.code.size();
+    bool changed = true;
+    while (changed) {
+        changed = foldConstants(program.code);
+        changed = removeDeadCode(program.code) || changed;
+    }
+    return before - program.code.size();
+}
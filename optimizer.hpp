@@ -0,0 +1,20 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: optimizer.hpp
+ *  Project 2
+ *
+ *  @brief This file declares the optimization pass run over the
+ *         generated RPN before it is written: constant folding,
+ *         branch folding and unreachable code removal.
+ ***************************************************************/
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ir.hpp"
+
+#include <cstddef>
+
+size_t optimizeIR(IRProgram& program);
+
+#endif
@@ -10,48 +10,162 @@
 
 #include "parser.hpp"
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <thread>
+
 /*
     @brief Parameterized constructor
-    @param scanner Scanner object to be used for parsing
+    @param(s) scanner Scanner object to be used for parsing
+              out stream for progress messages and diagnostics
+              err stream for unexpected internal failures
+              tokens if set, the scanner's tokens, already lexed by
+                     TokenBuffer::lex(); the scanner then only locates
+                     diagnostics
     @return N/A
 */
-Parser::Parser(Scanner& scanner) : scanner(scanner), lastLabel(-1), IR() {
-    lookahead = scanner.nextToken();
+Parser::Parser(Scanner& scanner, std::ostream& out, std::ostream& err, const TokenBuffer* tokens)
+    : scanner(scanner), out(out), err(err), tokens(tokens), replayAt(tokens != nullptr ? tokens->firstReplay() : SIZE_MAX),
+      lastLabel(-1), declared(0), IR() {
+    nextToken();
 }
 
 
 /*
-    @brief parses the input source code
+    @brief constructor for one piece of a parallel parse: the piece
+           sees the parent's declarations and numbers its own labels
+           and new variables from where the parent's end. Its first
+           token is only read by nextToken(), on the piece's thread
+    @param(s) parent the parser whose declarations are done
+              first the piece's first token in the parent's token buffer
+              out stream for the piece's messages
     @return N/A
 */
-void Parser::parse(const std::string& inputFileName) 
+Parser::Parser(const Parser& parent, size_t first, std::ostream& out)
+    : scanner(parent.scanner), out(out), err(parent.err), tokens(parent.tokens), tokenIndex(first),
+      replayAt(parent.tokens->firstReplay(first)), lastLabel(-1), declared(parent.declared), IR(parent.IR) {
+    IR.code.clear();
+}
+
+
+/*
+    @brief parses the input source code
+    @return true if the program is legal and its RPN was written, false otherwise
+*/
+bool Parser::parse(const std::string& inputFileName) 
 {
-    std::cout << "Compiling " << inputFileName << "..." << std::endl;
+    out << "Compiling " << inputFileName << "..." << std::endl;
+    double phaseStart = stats != nullptr ? CompileStats::now() : 0;
     try{
         program();
-        if (lookahead.type != "endSym") {
-            error("Expected end. but found " + lookahead.type);
+        if (lookahead.type != TokenKind::endSym) {
+            error(std::string("Expected end. but found ") + tokenKindName(lookahead.type));
+        }
+        out << "Success! The program is legal!" << std::endl;
+        if (stats != nullptr) {
+            for (const Instr& instr : IR.code) {
+                stats->instructions[static_cast<size_t>(instr.op)]++;
+            }
+            stats->symbols += IR.symbolCount();
+            lap(CompileStats::PARSE, phaseStart);
+        }
+
+        if (output.optimize > 0) {
+            size_t before = IR.code.size();
+            size_t removed = optimizeIR(IR);
+            out << "Optimizer removed " << removed << " of " << before << " instructions" << std::endl;
+            lap(CompileStats::OPTIMIZE, phaseStart);
         }
-        std::cout << "Success! The program is legal!" << std::endl;
 
-        std::string outputFileName = inputFileName + ".txt";
-        printRPN(outputFileName);
+        if (output.link) {
+            LinkStats linked;
+            std::string errorMsg;
+            if (!linkIR(IR, linked, errorMsg)) {
+                err << "Error: " << errorMsg << std::endl;
+                return false;
+            }
+            out << "Linker resolved " << linked.branches << " branches to " << linked.labels << " labels, threaded "
+                << linked.threaded << std::endl;
+            lap(CompileStats::LINK, phaseStart);
+        }
+
+        bool written = true;
+        if (output.text && output.registers > 0) {
+            written = printRegisterCode(inputFileName + ".reg") && written;
+        } else if (output.text) {
+            written = printRPN(inputFileName + ".txt") && written;
+        }
+        if (output.bytecode) {
+            written = printBytecode(inputFileName + ".bc") && written;
+        }
+        lap(CompileStats::WRITE, phaseStart);
+        return written;
 
+    }catch (const CompileError&){
+        // already reported by error()
+        lap(CompileStats::PARSE, phaseStart);
+        return false;
     }catch (const std::exception& e){
-        std::cerr << "parsing error: " << e.what() << std::endl;
+        err << "parsing error: " << e.what() << std::endl;
+        lap(CompileStats::PARSE, phaseStart);
+        return false;
     }
 }
 
 
 /*
-    @brief prints an error message
-    @param message the error message to be printed
+    @brief adds the time since start to a phase, if stats are collected
+    @param(s) phase the phase that just ended
+              start when it began; receives the current time
     @return N/A
 */
+void Parser::lap(CompileStats::Phase phase, double& start)
+{
+    if (stats != nullptr) {
+        double end = CompileStats::now();
+        stats->seconds[phase] += end - start;
+        start = end;
+    }
+}
+
+
+/*
+    @brief prints an error message at the line and column of the
+           lookahead token and abandons the parse
+    @param message the error message to be printed
+    @return N/A, throws CompileError
+*/
 void Parser::error(const std::string& message)
 {
-    std::cout << ">>> Error line " << scanner.getLineNumber() << ": " << message << std::endl;
-    exit(1);
+    error(message, lookahead.offset);
+}
+
+
+/*
+    @brief prints an error message at the line and column of a source
+           offset and abandons the parse
+    @param(s) message the error message to be printed
+              offset where the offending token starts
+    @return N/A, throws CompileError
+*/
+void Parser::error(const std::string& message, size_t offset)
+{
+    error(message, scanner.locate(offset));
+}
+
+
+/*
+    @brief prints an error message at a line and column already looked
+           up and abandons the parse
+    @param(s) message the error message to be printed
+              at where the offending token starts
+    @return N/A, throws CompileError
+*/
+void Parser::error(const std::string& message, const SourceLocation& at)
+{
+    out << ">>> Error line " << at.line << ":" << at.column << ": " << message << std::endl;
+    throw CompileError(message);
 }
 
 
@@ -60,14 +174,14 @@ void Parser::error(const std::string& message)
     @param expectedToken the expected token
     @return N/A
 */
-void Parser::formatError(const std::string& expectedToken)
+void Parser::formatError(TokenKind expectedToken)
 {
     std::stringstream errorMsg;
-    errorMsg << "Expected '" << expectedToken << "' but found '" << lookahead.type << "' with lexeme '";
+    errorMsg << "Expected '" << tokenKindName(expectedToken) << "' but found '" << tokenKindName(lookahead.type) << "' with lexeme '";
     if (std::holds_alternative<int>(lookahead.value)) {
         errorMsg << std::get<int>(lookahead.value);
-    } else if (std::holds_alternative<std::string>(lookahead.value)) {
-        errorMsg << std::get<std::string>(lookahead.value);
+    } else if (std::holds_alternative<std::string_view>(lookahead.value)) {
+        errorMsg << std::get<std::string_view>(lookahead.value);
     } else {
         errorMsg << "none";
      }
@@ -81,11 +195,11 @@ void Parser::formatError(const std::string& expectedToken)
     @param expectedToken the expected token
     @return N/A
 */
-void Parser::expect(const std::string& expectedToken)
+void Parser::expect(TokenKind expectedToken)
 {
     if (lookahead.type == expectedToken) {
-        if (expectedToken != "endSym") {
-            lookahead = scanner.nextToken(); 
+        if (expectedToken != TokenKind::endSym) {
+            nextToken(); 
         }
     } else {
         formatError(expectedToken);
@@ -101,12 +215,15 @@ void Parser::expect(const std::string& expectedToken)
 */
 void Parser::program()
 {
-    expect("beginSym");
+    expect(TokenKind::beginSym);
     VarDeclarations();
-    while(lookahead.type != "endSym"){
+    if (threads > 1 && tokens != nullptr) {
+        ParallelStmts();
+    }
+    while(lookahead.type != TokenKind::endSym){
         Stmts();
     }
-    expect("endSym");
+    expect(TokenKind::endSym);
 }
 
 
@@ -118,74 +235,86 @@ void Parser::program()
 */
 void Parser::assignment()
 {
-    std::string id = Identifier();
-    expect("assignSym"); 
+    int32_t slot = Variable();
+    expect(TokenKind::assignSym); 
     expression(); 
-    emit("STORE", id); 
+    emit(Op::STORE, slot); 
 }
 
 
 /*
-    @brief defines what an expression should look like
+    @brief defines what an expression should look like. Parentheses
+           and pending operators are kept on an explicit stack rather
+           than in recursive calls, so nesting depth is only limited
+           by memory; the RPN comes out in the order the recursive
+           grammar below gives
     @return N/A
 
     Syntax: Term { ("+" | "-") Term } ;
+            Term: factor { ("*" | "/") factor } ;
 */
 void Parser::expression()
 {
-    term();
-    while(lookahead.type == "plusSym" || lookahead.type == "minusSym")
-    {
-        std::string op = lookahead.type;
-        scan();
-        term();
-        emit(opMap[op], "");
-    }
-}
-
-
-/*
-    @brief defines what an assignment should look like
-    @return N/A
-
-    Syntax: factor { ("*" | "/") factor } ;
-*/
-void Parser::term()
-{
-    factor();
-    while (lookahead.type == "timesSym" || lookahead.type == "divSym")
-    {
-        std::string op = lookahead.type;
-        scan();
+    size_t base = operators.size();
+    while (true) {
+        // a factor: open any parentheses, then an identifier or number
+        while (lookahead.type == TokenKind::lParen) {
+            operators.push_back(TokenKind::lParen);
+            scan();
+        }
         factor();
-        emit(opMap[op], "");
+
+        // operators after it, each closing the ones it binds looser than
+        while (true) {
+            TokenKind op = lookahead.type;
+            bool multiplicative = op == TokenKind::timesSym || op == TokenKind::divSym;
+            bool additive = op == TokenKind::plusSym || op == TokenKind::minusSym;
+            while (operators.size() > base && operators.back() != TokenKind::lParen
+                   && (additive || !multiplicative
+                       || operators.back() == TokenKind::timesSym || operators.back() == TokenKind::divSym)) {
+                emit(opCode(operators.back()), 0);
+                operators.pop_back();
+            }
+            if (multiplicative || additive) {
+                operators.push_back(op);
+                scan();
+                break;
+            }
+            if (operators.size() == base) {
+                return;
+            }
+            // the end of a parenthesized expression
+            expect(TokenKind::rParen);
+            operators.pop_back();
+        }
     }
 }
 
 
 /*
-    @brief defines what an assignment should look like
+    @brief parses a factor other than a parenthesized expression
     @return N/A
 
-    Syntax: identifier | numConstant | "(" Expr ")" ;
+    Syntax: identifier | numConstant ;
 */
 void Parser::factor()
 {
-    if (lookahead.type == "identifier") {
+    if (lookahead.type == TokenKind::identifier) {
         
-        if (!std::holds_alternative<std::string>(lookahead.value)) {
+        if (!std::holds_alternative<std::string_view>(lookahead.value)) {
             error("Expected identifier value to be a string");
         }
-        std::string id = std::get<std::string>(lookahead.value);
+        std::string_view id = std::get<std::string_view>(lookahead.value);
         
-        if (symbolTable.find(id) == symbolTable.end()) {
-            error("Undefined variable " + id);
+        int32_t slot = IR.lookup(id);
+        if (slot < 0 || slot >= declared) {
+            error("Undefined variable " + std::string(id));
         }
         
-        emit("EVAL", id);
+        emit(Op::EVAL, slot);
         scan();
         } 
-        else if (lookahead.type == "numConstant") {
+        else if (lookahead.type == TokenKind::numConstant) {
             
             if (!std::holds_alternative<int>(lookahead.value)) {
             error("Expected numeric value to be an integer");
@@ -193,13 +322,8 @@ void Parser::factor()
 
             int numValue = std::get<int>(lookahead.value);
         
-            emit("PUSH", std::to_string(numValue));
-            scan();
-        } 
-        else if (lookahead.type == "lParen") {
+            emit(Op::PUSH, numValue);
             scan();
-            expression();
-            expect("rParen");
         } 
         else {
             error("Expected identifier, number, or left parenthesis");
@@ -207,26 +331,101 @@ void Parser::factor()
 }
 
 
+/*
+    @brief maps an arithmetic operator token to its RPN operation
+    @param op the operator token kind
+    @return the RPN operation
+*/
+Op Parser::opCode(TokenKind op)
+{
+    switch (op) {
+        case TokenKind::plusSym:  return Op::PLUS;
+        case TokenKind::minusSym: return Op::MINUS;
+        case TokenKind::timesSym: return Op::TIMES;
+        default:                  return Op::DIV;
+    }
+}
+
+
 /*
     @brief Create distinct symbolic labels L0, L1, etc
-    @return the new label
+    @return the new label number
 */
-std::string Parser::newLabel()
+int Parser::newLabel()
 {
     lastLabel++;
-    return "L" + std::to_string(lastLabel);
+    return lastLabel;
 }
 
 
 /*
     @brief Emits one RPN operation into RPN stream
-    @param(s)  tag: token type 
-               item: token value 
+    @param(s)  op: RPN operation
+               arg: constant, symbol id or label number, 0 if none
     @return N/A
 */
-void Parser::emit(const std::string& tag, const std::string& item = "")
+void Parser::emit(Op op, int32_t arg)
 {
-    IR.push_back({tag, item});
+    IR.emit(op, arg);
+}
+
+
+/*
+    @brief selects which output files are written and how
+    @param options the output options
+    @return N/A
+*/
+void Parser::setOutputOptions(const OutputOptions& options)
+{
+    output = options;
+}
+
+
+/*
+    @brief starts or stops collecting phase times and IR counts. The
+           scanner's token stats are attached to the Scanner itself,
+           before the Parser reads the first token
+    @param stats where to collect them, nullptr to stop
+    @return N/A
+*/
+void Parser::setStats(CompileStats* stats)
+{
+    this->stats = stats;
+}
+
+
+/*
+    @brief lets the statements be parsed in pieces on several threads,
+           which only happens when the tokens are pre-lexed
+    @param(s) threads how many threads may parse pieces
+              minPieceTokens the fewest tokens worth giving a thread
+    @return N/A
+*/
+void Parser::setThreads(unsigned threads, size_t minPieceTokens)
+{
+    this->threads = threads;
+    this->minPieceTokens = minPieceTokens;
+}
+
+
+/*
+    @brief reserves room in the RPN stream up front
+    @param instructions expected number of instructions
+    @return N/A
+*/
+void Parser::reserveIR(size_t instructions)
+{
+    IR.code.reserve(instructions);
+}
+
+
+/*
+    @brief gets the RPN generated by the last parse
+    @return the generated program
+*/
+const IRProgram& Parser::getIR() const
+{
+    return IR;
 }
 
 
@@ -236,7 +435,27 @@ void Parser::emit(const std::string& tag, const std::string& item = "")
 */
 void Parser::scan()
 {
-    lookahead = scanner.nextToken();
+    nextToken();
+}
+
+
+/*
+    @brief moves lookahead to the next token, from the scanner or,
+           when pre-lexed, from the token buffer, replaying the
+           diagnostics the scanner printed for it
+    @return N/A
+*/
+void Parser::nextToken()
+{
+    if (tokens == nullptr) {
+        lookahead = scanner.nextToken();
+        return;
+    }
+    size_t index = tokenIndex++;
+    if (index == replayAt) {
+        replayAt = tokens->replay(index, out);
+    }
+    tokens->load(index, lookahead);
 }
 
 /*
@@ -248,10 +467,10 @@ void Parser::scan()
 void Parser::Stmts()
 {
     Stmt();
-    while(lookahead.type == "semicolon")
+    while(lookahead.type == TokenKind::semicolon)
     {
-        expect("semicolon");
-        if(lookahead.type != "endSym"){
+        expect(TokenKind::semicolon);
+        if(lookahead.type != TokenKind::endSym){
             Stmt();
         }
     }
@@ -259,82 +478,231 @@ void Parser::Stmts()
 
 
 /*
-    @brief Parses one individual statement
+    @brief Parses statements as Stmts() does, up to the ";" at a token
+           index, which is left as the lookahead
+    @param stop index of the ";" to stop at, SIZE_MAX to go on to "end."
+    @return N/A
+*/
+void Parser::StmtsUntil(size_t stop)
+{
+    while (lookahead.type != TokenKind::endSym) {
+        Stmt();
+        while (lookahead.type == TokenKind::semicolon) {
+            if (tokenIndex - 1 == stop) {
+                return;
+            }
+            expect(TokenKind::semicolon);
+            if (lookahead.type != TokenKind::endSym) {
+                Stmt();
+            }
+        }
+    }
+}
+
+
+/*
+    @brief Parses the statements in pieces on separate threads. A body
+           is a single statement, so every ";" after the declarations
+           ends a top-level statement with nothing left open, and the
+           statement list is cut at the ";" nearest to equal shares of
+           the tokens. The first piece is parsed here as usual; each of
+           the others numbers its labels from 0 and its new variables
+           from the last declared slot, and they are appended in order,
+           renumbering both, with their messages printed up to the
+           first piece that failed. The IR and output are those of
+           parsing the statements in one go
+    @return N/A, rethrows the first piece's failure
+*/
+void Parser::ParallelStmts()
+{
+    size_t first = tokenIndex - 1;   // the lookahead
+    size_t count = tokens->size();
+    size_t pieces = std::min<size_t>(threads, (count - first) / std::max<size_t>(minPieceTokens, 1));
+    std::vector<size_t> starts = {first};
+    for (size_t p = 1; p < pieces; p++) {
+        size_t at = std::max(first + (count - first) / pieces * p, starts.back());
+        while (at < count && tokens->kind(at) != TokenKind::semicolon) {
+            at++;
+        }
+        if (at + 1 >= count) {
+            break;
+        }
+        if (at + 1 > starts.back()) {
+            starts.push_back(at + 1);
+        }
+    }
+    if (starts.size() < 2) {
+        return;
+    }
+
+    // index every line now, so the pieces only read the scanner
+    scanner.locate(SIZE_MAX);
+
+    struct Piece {
+        std::ostringstream messages;
+        std::unique_ptr<Parser> parser;
+        std::exception_ptr failure;
+    };
+    std::deque<Piece> parts(starts.size() - 1);
+    std::vector<std::thread> workers;
+    for (size_t p = 0; p < parts.size(); p++) {
+        Piece& part = parts[p];
+        part.parser.reset(new Parser(*this, starts[p + 1], part.messages));
+        size_t stop = p + 2 < starts.size() ? starts[p + 2] - 1 : SIZE_MAX;
+        workers.emplace_back([&part, stop]() {
+            try {
+                part.parser->nextToken();
+                part.parser->StmtsUntil(stop);
+            } catch (...) {
+                part.failure = std::current_exception();
+            }
+        });
+    }
+    std::exception_ptr failure;
+    try {
+        StmtsUntil(starts[1] - 1);
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    int32_t symbols = static_cast<int32_t>(declared);
+    int labelBase = lastLabel + 1;
+    size_t total = IR.code.size();
+    for (const Piece& part : parts) {
+        total += part.parser ? part.parser->IR.code.size() : 0;
+    }
+    IR.code.reserve(total);
+    std::vector<int32_t> slots;      // a piece's new variables -> their slots here
+    for (Piece& part : parts) {
+        out << part.messages.str();
+        if (part.failure) {
+            std::rethrow_exception(part.failure);
+        }
+        const Parser& piece = *part.parser;
+        slots.clear();
+        for (size_t slot = symbols; slot < piece.IR.symbolCount(); slot++) {
+            slots.push_back(IR.intern(piece.IR.symbolName(static_cast<int32_t>(slot))));
+        }
+        for (Instr instr : piece.IR.code) {
+            if (instr.op == Op::BZ || instr.op == Op::BR || instr.op == Op::LABEL) {
+                instr.arg += labelBase;
+            } else if (instr.op == Op::STORE && instr.arg >= symbols) {
+                instr.arg = slots[instr.arg - symbols];
+            }
+            IR.code.push_back(instr);
+        }
+        labelBase += piece.lastLabel + 1;
+    }
+    lastLabel = labelBase - 1;
+
+    // carry on after the last piece
+    const Parser& last = *parts.back().parser;
+    lookahead = last.lookahead;
+    tokenIndex = last.tokenIndex;
+    replayAt = last.replayAt;
+}
+
+
+/*
+    @brief Parses one individual statement. The ifs and whiles it
+           starts with are opened in a loop and closed from an explicit
+           stack once the innermost statement is parsed, so nesting
+           depth is only limited by memory
     @return N/A
 
     Syntax: Assign | Cond | Loop | "end."
 */
 void Parser::Stmt()
 {
-    if(lookahead.type == "identifier"){
-        assignment();
-    }
-    else if(lookahead.type == "ifSym"){
-        Cond();
+    size_t base = nested.size();
+    while (lookahead.type == TokenKind::ifSym || lookahead.type == TokenKind::whileSym) {
+        if (lookahead.type == TokenKind::ifSym) {
+            Cond();
+        } else {
+            Loop();
+        }
     }
-    else if(lookahead.type == "whileSym"){
-        Loop();
-    }else if(lookahead.type == "endSym"){
+
+    if(lookahead.type == TokenKind::identifier){
+        assignment();
+    }else if(lookahead.type == TokenKind::endSym){
         // end of program
     }
     else{
         error("id, if or while expected");
     }
+
+    // the innermost body is done: close its ifs and whiles
+    while (nested.size() > base) {
+        const Nested& open = nested.back();
+        if (open.loop) {
+            emit(Op::BR, open.repeatLabel);
+        }
+        emit(Op::LABEL, open.skipLabel);
+        nested.pop_back();
+    }
 }
 
 
 /*
-    @brief Parses conditions
+    @brief Parses the head of a condition; Stmt() parses its body
+           and closes it
     @return N/A
 
     Syntax: "if" "(" Expr ")" Stmt;
 */
 void Parser::Cond()
 {
-    std::string skipLabel = newLabel();
+    int skipLabel = newLabel();
     scan();
-    expect("lParen");
+    expect(TokenKind::lParen);
     expression();
-    expect("rParen");
-    emit("BZ", skipLabel);
-    Stmt();
-    emit("LABEL", skipLabel);
+    expect(TokenKind::rParen);
+    emit(Op::BZ, skipLabel);
+    nested.push_back({false, 0, skipLabel});
 }
 
 /*
-    @brief Parses loops
+    @brief Parses the head of a loop; Stmt() parses its body and
+           closes it
     @return N/A
 
     Syntax: "while" "(" Expr ")" Stmt ;
 */
 void Parser::Loop()
 {
-    std::string repeatLabel = newLabel();
-    std::string skiplabel = newLabel();
+    int repeatLabel = newLabel();
+    int skiplabel = newLabel();
     scan();
-    emit("LABEL", repeatLabel);
-    expect("lParen");
+    emit(Op::LABEL, repeatLabel);
+    expect(TokenKind::lParen);
     expression();
-    expect("rParen");
-    emit("BZ", skiplabel);
-    Stmt();
-    emit("BR", repeatLabel);
-    emit("LABEL", skiplabel);
+    expect(TokenKind::rParen);
+    emit(Op::BZ, skiplabel);
+    nested.push_back({true, repeatLabel, skiplabel});
 }
 
 /*
-    @brief semantic trick that identifies an identifier
+    @brief semantic trick that identifies an identifier; the name is
+           copied before scanning on, since a streaming scanner only
+           keeps the lookahead token's text
     @return returns name of identifier if true, empty string if false
 
     Syntax: "var" { LETTERS_DIGITS } 
 */
 std::string Parser::Identifier()
 {
-    if (lookahead.type == "identifier") {
-        if (!std::holds_alternative<std::string>(lookahead.value)) {
+    if (lookahead.type == TokenKind::identifier) {
+        if (!std::holds_alternative<std::string_view>(lookahead.value)) {
             error("Expected identifier value to be a string");
         }
-        std::string id = std::get<std::string>(lookahead.value);
+        std::string id(std::get<std::string_view>(lookahead.value));
         scan();
         return id;
     }
@@ -342,24 +710,82 @@ std::string Parser::Identifier()
     return "";
 }
 
+
+/*
+    @brief resolves the variable being assigned to its slot. Assigning
+           to an undeclared variable is allowed; it gets a slot past
+           the declared ones
+    @return the variable's slot
+*/
+int32_t Parser::Variable()
+{
+    if (lookahead.type != TokenKind::identifier) {
+        error("Identifier expected");
+    }
+    if (!std::holds_alternative<std::string_view>(lookahead.value)) {
+        error("Expected identifier value to be a string");
+    }
+    int32_t slot = IR.intern(std::get<std::string_view>(lookahead.value));
+    scan();
+    return slot;
+}
+
 /*
     @brief Writes the generated RPN to an output file
-    @return N/A
+    @return true if the file was written, false otherwise
 */
-void Parser::printRPN(const std::string& outputFileName)
+bool Parser::printRPN(const std::string& outputFileName)
 {
-    std::ofstream outputFile(outputFileName);
+    RPNWriter writer(output.format);
+    std::string errorMsg;
+    if (!writer.write(IR, outputFileName, errorMsg)) {
+        err << "Error: " << errorMsg << std::endl;
+        return false;
+    }
+    out << "Generated RPN code written to " << outputFileName << std::endl;
 
-    for(const auto& x : IR){
-        if(x.second.empty()){
-            outputFile << "['" << x.first << "']" << std::endl;
-        }else {
-            outputFile << "['" << x.first << ", '" << x.second << "']" << std::endl;
-        }
+    if (output.stats) {
+        RPNWriter::printStats(writer.getStats(), out);
     }
+    return true;
+}
+
 
-    outputFile.close();
-    std::cout << "Generated RPN code written to " << outputFileName << std::endl;
+/*
+    @brief Writes the generated RPN to a binary bytecode file
+    @return true if the file was written, false otherwise
+*/
+bool Parser::printBytecode(const std::string& outputFileName)
+{
+    std::string errorMsg;
+    if (!writeBytecode(IR, outputFileName, errorMsg)) {
+        err << "Error: " << errorMsg << std::endl;
+        return false;
+    }
+    out << "Generated bytecode written to " << outputFileName << std::endl;
+    return true;
+}
+
+
+/*
+    @brief Generates register code from the RPN and writes it to a
+           .reg file
+    @return true if the file was written, false otherwise
+*/
+bool Parser::printRegisterCode(const std::string& outputFileName)
+{
+    RegisterProgram registerCode;
+    std::string errorMsg;
+    if (!generateRegisterCode(IR, output.registers, registerCode, errorMsg)
+        || !writeRegisterCode(registerCode, outputFileName, errorMsg)) {
+        err << "Error: " << errorMsg << std::endl;
+        return false;
+    }
+    out << "Register allocator placed " << registerCode.values << " values in " << registerCode.usedRegisters
+        << " of " << registerCode.registers << " registers and " << registerCode.spillSlots << " spill slots"
+        << std::endl;
+    out << "Generated register code written to " << outputFileName << std::endl;
+    return true;
 }
 
 
@@ -369,26 +795,40 @@ void Parser::printRPN(const std::string& outputFileName)
 
     Syntax: "var" IdentifierList ";" { "var" IdentifierList ";" }
 
-    Note: IdentifierList refers to the symbolTable holding identifiers
+    Note: each declared variable gets the next slot in the IR's
+          symbol table, so slots [0, declared) are the declared ones
 */
 void Parser::VarDeclarations()
 {
-    while (lookahead.type == "varSym") {
-        expect("varSym"); 
+    while (lookahead.type == TokenKind::varSym) {
+        expect(TokenKind::varSym); 
 
         do {
-            std::string varName = Identifier(); 
-            if (symbolTable.find(varName) != symbolTable.end()) {
-                error("Illegal redefinition of variable " + varName);
-            } else {
-                symbolTable.insert(varName); 
+            // a redefinition is located while the name is the lookahead,
+            // as a streaming scanner may drop it once the next token is
+            // scanned, but reported after that token's own diagnostics
+            std::string redefined;
+            SourceLocation at{0, 0};
+            if (lookahead.type == TokenKind::identifier && std::holds_alternative<std::string_view>(lookahead.value)) {
+                std::string_view varName = std::get<std::string_view>(lookahead.value);
+                int32_t slot = IR.intern(varName);
+                if (slot < declared) {
+                    redefined = varName;
+                    at = scanner.locate(lookahead.offset);
+                } else {
+                    declared = slot + 1;
+                }
+            }
+            Identifier();
+            if (!redefined.empty()) {
+                error("Illegal redefinition of variable " + redefined, at);
             }
 
-            if (lookahead.type == "comma") {
-                expect("comma");
+            if (lookahead.type == TokenKind::comma) {
+                expect(TokenKind::comma);
             }
-        } while (lookahead.type == "identifier");
+        } while (lookahead.type == TokenKind::identifier);
 
-        expect("semicolon");
+        expect(TokenKind::semicolon);
     }
 }
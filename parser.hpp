@@ -9,54 +9,114 @@
 ***************************************************************/
 
 #include "scanner.hpp"
-#include <unordered_set>
+#include "ir.hpp"
+#include "rpn_writer.hpp"
+#include "bytecode.hpp"
+#include "optimizer.hpp"
+#include "linker.hpp"
+#include "register_code.hpp"
+#include "compile_stats.hpp"
+#include "token_buffer.hpp"
 #include <sstream>
 #include <vector>
 #include <optional>
+#include <stdexcept>
 
 #ifndef PARSER_H
 #define PARSER_H
 
+// which output files are produced for a legal program
+struct OutputOptions {
+    RPNWriter::Format format = RPNWriter::Format::TEXT;
+    bool text = true;          // <input>.txt, or <input>.reg from the register backend
+    bool bytecode = false;     // <input>.bc
+    bool stats = false;        // report output throughput
+    int optimize = 0;          // -O level: 0 writes the RPN as parsed
+    bool link = false;         // resolve labels to instruction indexes before writing
+    unsigned registers = 0;    // register backend with this many registers, 0 for stack RPN
+};
+
+// thrown by Parser::error once the diagnostic has been reported
+struct CompileError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
 class Parser 
 {
 public:
+    // below this many tokens per piece another thread does not pay off
+    static constexpr size_t MIN_PIECE_TOKENS = 64 * 1024;
+
     // public function declarations
-    Parser(Scanner& scanner);
-    void parse(const std::string& inputFileName);
+    Parser(Scanner& scanner, std::ostream& out = std::cout, std::ostream& err = std::cerr,
+           const TokenBuffer* tokens = nullptr);
+    bool parse(const std::string& inputFileName);
+    void reserveIR(size_t instructions);
+    void setOutputOptions(const OutputOptions& options);
+    void setStats(CompileStats* stats);
+    void setThreads(unsigned threads, size_t minPieceTokens = MIN_PIECE_TOKENS);
+    const IRProgram& getIR() const;
 
 private:
+    // re-parses single statements with the grammar rules below
+    friend class IncrementalCompiler;
+
     // private member variables
     Scanner& scanner;
+    std::ostream& out;     // progress messages and diagnostics
+    std::ostream& err;     // unexpected internal failures
     Token lookahead;
-    std::unordered_set<std::string> symbolTable;
+    const TokenBuffer* tokens;   // pre-lexed tokens, or nullptr to pull them from the scanner
+    size_t tokenIndex = 0;       // the next token to take from tokens
+    size_t replayAt;             // the next token with scanner diagnostics to replay
     int lastLabel;
-    std::vector<std::pair<std::string, std::string>> IR;
-    std::unordered_map<std::string, std::string> opMap {
-        {"plusSym", "PLUS"},
-        {"minusSym", "MINUS"},
-        {"timesSym", "TIMES"},
-        {"divSym", "DIV"}
+    int32_t declared;      // slots below this are declared variables
+    IRProgram IR;
+    OutputOptions output;
+    CompileStats* stats = nullptr;   // phase times and IR counts, if collected
+    unsigned threads = 1;            // threads parsing pieces of the statements
+    size_t minPieceTokens = MIN_PIECE_TOKENS;
+
+    // an if or while whose body is being parsed
+    struct Nested {
+        bool loop;
+        int repeatLabel;   // loops only
+        int skipLabel;
     };
 
+    // explicit parse stacks, kept between statements to reuse their memory
+    std::vector<TokenKind> operators;   // pending operators and '(' of expression()
+    std::vector<Nested> nested;         // ifs and whiles Stmt() has opened
+
 
     // private function declarations
+    Parser(const Parser& parent, size_t first, std::ostream& out);
+    void lap(CompileStats::Phase phase, double& start);
     void error(const std::string& message);
-    void formatError(const std::string& expectedToken);
-    void expect(const std::string& expectedToken);
+    void error(const std::string& message, size_t offset);
+    void error(const std::string& message, const SourceLocation& at);
+    void formatError(TokenKind expectedToken);
+    void expect(TokenKind expectedToken);
+    static Op opCode(TokenKind op);
     void program();
     void assignment();
     void expression();
-    void term();
     void factor();
-    std::string newLabel();
-    void emit(const std::string& tag, const std::string& item );
+    int newLabel();
+    void emit(Op op, int32_t arg);
     void scan();
+    void nextToken();
     void Stmts();
+    void StmtsUntil(size_t stop);
+    void ParallelStmts();
     void Stmt();
     void Cond();
     void Loop();
     std::string Identifier();
-    void printRPN(const std::string& outputFileName);
+    int32_t Variable();
+    bool printRPN(const std::string& outputFileName);
+    bool printBytecode(const std::string& outputFileName);
+    bool printRegisterCode(const std::string& outputFileName);
     void VarDeclarations();
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,420 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: register_code.cpp
+ *  Project 2
+ *
+ *  @brief Contains the translation of RPN into three-address code,
+ *         the linear-scan register allocator and the .reg writer
+ ***************************************************************/
+
+#include "register_code.hpp"
+#include "source_file.hpp"
+
+#include <algorithm>
+
+// the instructions a virtual register is live over
+struct LiveRange {
+    size_t start;               // where it is written
+    size_t end;                 // where it is last read
+    bool dead;                  // renamed to a variable by a STORE
+};
+
+// RPN arithmetic and its three-address form
+static const RegOp ARITHMETIC[] = { RegOp::ADD, RegOp::SUB, RegOp::MUL, RegOp::DIV };
+
+
+/*
+    @brief translates the RPN into three-address code over unlimited
+           virtual registers, recording where each one is live
+    @param(s) program the RPN, linked or not
+              result receives the code and the variable names
+              live receives each virtual register's live range
+              errorMsg receives the reason on failure
+    @return true on success, false for RPN the stack VM would reject
+            or that leaves values on the stack at a label or branch
+*/
+static bool translate(const IRProgram& program, RegisterProgram& result, std::vector<LiveRange>& live,
+                      std::string& errorMsg)
+{
+    const std::vector<Instr>& rpn = program.code;
+
+    // a linked program's branch targets become labels again
+    std::vector<int32_t> labelAt;
+    if (program.linked) {
+        labelAt.assign(rpn.size() + 1, -1);
+        for (const Instr& instr : rpn) {
+            if (instr.op != Op::BZ && instr.op != Op::BR) {
+                continue;
+            }
+            if (instr.arg < 0 || static_cast<size_t>(instr.arg) > rpn.size()) {
+                errorMsg = "Branch to invalid instruction " + std::to_string(instr.arg);
+                return false;
+            }
+            labelAt[instr.arg] = 0;
+        }
+        int32_t next = 0;
+        for (int32_t& label : labelAt) {
+            label = (label == 0) ? next++ : -1;
+        }
+    }
+
+    std::vector<RegInstr>& code = result.code;
+    code.reserve(rpn.size() / 2 + 1);
+    std::vector<Operand> stack;
+
+    auto fresh = [&]() {
+        live.push_back(LiveRange{code.size(), code.size(), false});
+        return Operand{Operand::Kind::REG, static_cast<int32_t>(live.size() - 1)};
+    };
+    auto use = [&](const Operand& operand) {
+        if (operand.kind == Operand::Kind::REG) {
+            live[operand.value].end = code.size();
+        }
+    };
+    auto pop = [&](size_t at, Operand& operand) {
+        if (stack.empty()) {
+            errorMsg = "Stack underflow at instruction " + std::to_string(at);
+            return false;
+        }
+        operand = stack.back();
+        stack.pop_back();
+        return true;
+    };
+    // no virtual register may be live across a label or branch
+    auto boundary = [&](size_t at) {
+        if (!stack.empty()) {
+            errorMsg = "Values left on the stack at instruction " + std::to_string(at)
+                     + ", which the register backend cannot keep across a label or branch";
+            return false;
+        }
+        return true;
+    };
+    auto symbol = [&](const Instr& instr) {
+        if (instr.arg < 0 || static_cast<size_t>(instr.arg) >= program.symbolCount()) {
+            errorMsg = "Invalid symbol id " + std::to_string(instr.arg);
+            return false;
+        }
+        return true;
+    };
+    auto target = [&](const Instr& instr) {
+        return program.linked ? labelAt[instr.arg] : instr.arg;
+    };
+
+    for (size_t i = 0; i < rpn.size(); i++) {
+        const Instr& instr = rpn[i];
+        if (program.linked && labelAt[i] >= 0) {
+            if (!boundary(i)) {
+                return false;
+            }
+            code.push_back(RegInstr{RegOp::LABEL, labelAt[i], {}, {}, {}});
+        }
+
+        Operand a;
+        Operand b;
+        switch (instr.op) {
+            case Op::PUSH:
+                stack.push_back(Operand{Operand::Kind::CONST, instr.arg});
+                break;
+
+            case Op::EVAL:
+                if (!symbol(instr)) {
+                    return false;
+                }
+                stack.push_back(Operand{Operand::Kind::VAR, instr.arg});
+                break;
+
+            case Op::STORE: {
+                if (!symbol(instr) || !pop(i, a)) {
+                    return false;
+                }
+                // the stack VM read a variable still waiting on the stack
+                // when it was pushed, so copy it before it changes
+                for (Operand& waiting : stack) {
+                    if (waiting.kind == Operand::Kind::VAR && waiting.value == instr.arg) {
+                        Operand copy = fresh();
+                        code.push_back(RegInstr{RegOp::MOV, 0, copy, waiting, {}});
+                        waiting = copy;
+                    }
+                }
+                Operand variable{Operand::Kind::VAR, instr.arg};
+                if (a.kind == Operand::Kind::REG && !code.empty() && code.back().dst.kind == Operand::Kind::REG
+                    && code.back().dst.value == a.value) {
+                    // every value is read once, so the register is not needed
+                    code.back().dst = variable;
+                    live[a.value].dead = true;
+                } else {
+                    use(a);
+                    code.push_back(RegInstr{RegOp::MOV, 0, variable, a, {}});
+                }
+                break;
+            }
+
+            case Op::PLUS:
+            case Op::MINUS:
+            case Op::TIMES:
+            case Op::DIV: {
+                if (!pop(i, b) || !pop(i, a)) {
+                    return false;
+                }
+                use(a);
+                use(b);
+                Operand sum = fresh();
+                RegOp op = ARITHMETIC[static_cast<size_t>(instr.op) - static_cast<size_t>(Op::PLUS)];
+                code.push_back(RegInstr{op, 0, sum, a, b});
+                stack.push_back(sum);
+                break;
+            }
+
+            case Op::BZ:
+                if (!pop(i, a) || !boundary(i)) {
+                    return false;
+                }
+                use(a);
+                code.push_back(RegInstr{RegOp::JZ, target(instr), {}, a, {}});
+                break;
+
+            case Op::BR:
+                if (!boundary(i)) {
+                    return false;
+                }
+                code.push_back(RegInstr{RegOp::JMP, target(instr), {}, {}, {}});
+                break;
+
+            case Op::LABEL:
+                if (program.linked) {
+                    errorMsg = "Label L" + std::to_string(instr.arg) + " in a linked program";
+                    return false;
+                }
+                if (!boundary(i)) {
+                    return false;
+                }
+                code.push_back(RegInstr{RegOp::LABEL, instr.arg, {}, {}, {}});
+                break;
+
+            default:
+                errorMsg = "Unknown opcode at instruction " + std::to_string(i);
+                return false;
+        }
+    }
+
+    // values left at the end are never read and are dropped
+    if (program.linked && labelAt[rpn.size()] >= 0) {
+        if (!boundary(rpn.size())) {
+            return false;
+        }
+        code.push_back(RegInstr{RegOp::LABEL, labelAt[rpn.size()], {}, {}, {}});
+    }
+    return true;
+}
+
+
+/*
+    @brief assigns every live virtual register a physical register or
+           a spill slot by linear scan. A register read for the last
+           time by an instruction may be written by the same one
+    @param(s) live the live ranges, in order of their start
+              result supplies the register file size and receives the
+                     allocation counts
+              where receives each virtual register's register, or
+                    -1 - its spill slot
+    @return N/A
+*/
+static void allocate(const std::vector<LiveRange>& live, RegisterProgram& result, std::vector<int32_t>& where)
+{
+    auto byEnd = [&](size_t x, size_t y) {
+        return live[x].end < live[y].end;
+    };
+    where.assign(live.size(), 0);
+
+    // registers first; when none is free the range that ends last,
+    // this one or an active one, goes to memory
+    std::vector<size_t> active;             // by increasing end
+    std::vector<int32_t> freeRegisters;
+    for (unsigned r = result.registers; r > 0; r--) {
+        freeRegisters.push_back(static_cast<int32_t>(r - 1));
+    }
+    std::vector<size_t> spilled;
+    for (size_t v = 0; v < live.size(); v++) {
+        if (live[v].dead) {
+            continue;
+        }
+        result.values++;
+        while (!active.empty() && live[active.front()].end <= live[v].start) {
+            freeRegisters.push_back(where[active.front()]);
+            active.erase(active.begin());
+        }
+        if (!freeRegisters.empty()) {
+            where[v] = freeRegisters.back();
+            freeRegisters.pop_back();
+            result.usedRegisters = std::max(result.usedRegisters, static_cast<unsigned>(where[v] + 1));
+        } else if (!active.empty() && live[active.back()].end > live[v].end) {
+            size_t victim = active.back();
+            active.pop_back();
+            where[v] = where[victim];
+            spilled.push_back(victim);
+        } else {
+            spilled.push_back(v);
+            continue;
+        }
+        active.insert(std::upper_bound(active.begin(), active.end(), v, byEnd), v);
+    }
+
+    // then spill slots, reused once free, as many as it takes
+    auto byStart = [&](size_t x, size_t y) {
+        return live[x].start < live[y].start;
+    };
+    std::sort(spilled.begin(), spilled.end(), byStart);
+    active.clear();
+    std::vector<int32_t> freeSlots;
+    for (size_t v : spilled) {
+        while (!active.empty() && live[active.front()].end <= live[v].start) {
+            freeSlots.push_back(-1 - where[active.front()]);
+            active.erase(active.begin());
+        }
+        int32_t slot;
+        if (freeSlots.empty()) {
+            slot = static_cast<int32_t>(result.spillSlots++);
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        where[v] = -1 - slot;
+        active.insert(std::upper_bound(active.begin(), active.end(), v, byEnd), v);
+    }
+    result.spilled = spilled.size();
+}
+
+
+/*
+    @brief generates register code for a program
+    @param(s) program the RPN, linked or not
+              registers size of the register file; 0 keeps every
+                        temporary in memory
+              result receives the code
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool generateRegisterCode(const IRProgram& program, unsigned registers, RegisterProgram& result,
+                          std::string& errorMsg)
+{
+    result = RegisterProgram();
+    result.registers = registers;
+    result.names.reserve(program.symbolCount());
+    for (size_t id = 0; id < program.symbolCount(); id++) {
+        result.names.push_back(program.symbolName(static_cast<int32_t>(id)));
+    }
+
+    std::vector<LiveRange> live;
+    if (!translate(program, result, live, errorMsg)) {
+        return false;
+    }
+    std::vector<int32_t> where;
+    allocate(live, result, where);
+
+    for (RegInstr& instr : result.code) {
+        for (Operand* operand : {&instr.dst, &instr.a, &instr.b}) {
+            if (operand->kind == Operand::Kind::REG) {
+                int32_t place = where[operand->value];
+                operand->kind = place >= 0 ? Operand::Kind::REG : Operand::Kind::SPILL;
+                operand->value = place >= 0 ? place : -1 - place;
+            }
+        }
+    }
+    return true;
+}
+
+
+/*
+    @brief counts the instructions that execute, leaving out labels
+    @return the instruction count
+*/
+size_t RegisterProgram::instructionCount() const
+{
+    size_t count = 0;
+    for (const RegInstr& instr : code) {
+        count += (instr.op != RegOp::LABEL) ? 1 : 0;
+    }
+    return count;
+}
+
+
+/*
+    @brief appends the text of one operand
+    @param(s) program the program the operand belongs to
+              operand the operand
+              text receives its text
+    @return N/A
+*/
+static void appendOperand(const RegisterProgram& program, const Operand& operand, std::string& text)
+{
+    switch (operand.kind) {
+        case Operand::Kind::CONST:
+            text += std::to_string(operand.value);
+            break;
+        case Operand::Kind::VAR:
+            text += program.names[operand.value];
+            break;
+        case Operand::Kind::REG:
+            text += "%r" + std::to_string(operand.value);
+            break;
+        case Operand::Kind::SPILL:
+            text += "%s" + std::to_string(operand.value);
+            break;
+        default:
+            break;
+    }
+}
+
+
+/*
+    @brief formats a program in the .reg text format
+    @param(s) program the register code
+              text receives the text
+    @return N/A
+*/
+void formatRegisterCode(const RegisterProgram& program, std::string& text)
+{
+    text.clear();
+    text.reserve(program.code.size() * 16);
+    text += "; " + std::to_string(program.registers) + " registers, " + std::to_string(program.usedRegisters)
+          + " used, " + std::to_string(program.spillSlots) + " spill slots\n";
+
+    for (const RegInstr& instr : program.code) {
+        if (instr.op == RegOp::LABEL) {
+            text += "L" + std::to_string(instr.label) + ":\n";
+            continue;
+        }
+        text += REG_OP_NAMES[static_cast<size_t>(instr.op)];
+        text += ' ';
+        if (instr.op == RegOp::JMP) {
+            text += "L" + std::to_string(instr.label);
+        } else if (instr.op == RegOp::JZ) {
+            appendOperand(program, instr.a, text);
+            text += ", L" + std::to_string(instr.label);
+        } else {
+            appendOperand(program, instr.dst, text);
+            text += ", ";
+            appendOperand(program, instr.a, text);
+            if (instr.op != RegOp::MOV) {
+                text += ", ";
+                appendOperand(program, instr.b, text);
+            }
+        }
+        text += '\n';
+    }
+}
+
+
+/*
+    @brief writes a program to a .reg file
+    @param(s) program the register code
+              path the file to write
+              errorMsg receives the reason on failure
+    @return true if the file was written, false otherwise
+*/
+bool writeRegisterCode(const RegisterProgram& program, const std::string& path, std::string& errorMsg)
+{
+    std::string text;
+    formatRegisterCode(program, text);
+    return writeFile(path, text, errorMsg);
+}
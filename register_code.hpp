@@ -0,0 +1,108 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: register_code.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the register backend selected with
+ *         --backend=register: three-address code translated from the
+ *         stack RPN, with temporaries kept in a bounded register file
+ *         by a linear-scan allocator.
+ *
+ *         The translation runs the RPN on a stack of operands instead
+ *         of values. PUSH and EVAL cost nothing, they only push a
+ *         constant or a variable; an operator pops two operands and
+ *         emits one instruction into a fresh virtual register, and a
+ *         STORE renames the register the last instruction wrote to
+ *         the variable. "a = b+c+d+e+f+ghijk" is 12 RPN instructions
+ *         and 5 here. The stack is empty at every label and branch in
+ *         RPN from the parser, so no value lives across one and every
+ *         virtual register is live over one straight stretch of code.
+ *
+ *         Linear scan (Poletto and Sarkar) then gives each virtual
+ *         register one of the physical ones. When all are taken, the
+ *         value whose use is furthest away goes to a spill slot, where
+ *         it stays for its whole life. Operands may be in memory, so a
+ *         spilled value needs no extra loads or stores.
+ *
+ *         Text format, written to <input>.reg, one item per line:
+ *           ; comment           the first line gives the register file
+ *           Ln:                 label n
+ *           MOV dst, a          dst = a
+ *           ADD dst, a, b       dst = a + b, likewise SUB, MUL and DIV
+ *           JZ a, Ln            jump to label n if a is 0
+ *           JMP Ln              jump to label n
+ *         An operand is a variable name, a decimal constant (only as
+ *         a source), a register %rN or a spill slot %sN. Arithmetic
+ *         wraps like the stack VM's, and DIV by 0 is a runtime error.
+ ***************************************************************/
+
+#ifndef REGISTER_CODE_H
+#define REGISTER_CODE_H
+
+#include "ir.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// three-address operations
+enum class RegOp : uint8_t {
+    MOV,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    JZ,         // operand a, jumps to label
+    JMP,        // jumps to label
+    LABEL,      // defines label
+    COUNT
+};
+
+// printable operation names
+inline constexpr const char* REG_OP_NAMES[] = {
+    "MOV", "ADD", "SUB", "MUL", "DIV", "JZ", "JMP", "LABEL"
+};
+
+static_assert(sizeof(REG_OP_NAMES) / sizeof(REG_OP_NAMES[0]) == static_cast<size_t>(RegOp::COUNT),
+              "every RegOp needs a name");
+
+// one operand and where it lives
+struct Operand {
+    enum class Kind : uint8_t { NONE, CONST, VAR, REG, SPILL };
+    Kind kind = Kind::NONE;
+    int32_t value = 0;          // constant, symbol id, register or spill slot
+};
+
+// one three-address instruction
+struct RegInstr {
+    RegOp op;
+    int32_t label;              // JZ, JMP and LABEL only
+    Operand dst;
+    Operand a;
+    Operand b;
+};
+
+class RegisterProgram {
+
+public:
+    // --registers when only --backend=register is given
+    static constexpr unsigned DEFAULT_REGISTERS = 8;
+
+    std::vector<RegInstr> code;
+    std::vector<std::string> names;     // symbol id -> variable name
+    unsigned registers = 0;             // size of the register file
+    unsigned usedRegisters = 0;
+    unsigned spillSlots = 0;
+    size_t values = 0;                  // virtual registers the allocator placed
+    size_t spilled = 0;                 // of those, in spill slots
+
+    size_t instructionCount() const;
+};
+
+bool generateRegisterCode(const IRProgram& program, unsigned registers, RegisterProgram& result,
+                          std::string& errorMsg);
+void formatRegisterCode(const RegisterProgram& program, std::string& text);
+bool writeRegisterCode(const RegisterProgram& program, const std::string& path, std::string& errorMsg);
+
+#endif
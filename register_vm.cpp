@@ -0,0 +1,330 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: register_vm.cpp
+ *  Project 2
+ *
+ *  @brief Contains the member function definitions for loading and
+ *         executing register code
+ ***************************************************************/
+
+#include "register_vm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED 1
+#endif
+
+/*
+    @brief loads a program: gives every operand its cell, strips the
+           LABELs, turns jump labels into instruction indexes and
+           appends a halt
+    @param(s) program the register code to load
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool RegisterVM::load(const RegisterProgram& program, std::string& errorMsg)
+{
+    code.clear();
+    threaded = false;
+    variables = program.names.size();
+    size_t spills = variables;
+    size_t registers = spills + program.spillSlots;
+    initial.assign(registers + program.registers, 0);
+
+    // where each label lands once LABELs are removed
+    std::vector<int32_t> target;
+    size_t placed = 0;
+    for (const RegInstr& instr : program.code) {
+        if (instr.op == RegOp::LABEL) {
+            if (instr.label < 0) {
+                errorMsg = "Invalid label L" + std::to_string(instr.label);
+                return false;
+            }
+            if (target.size() <= static_cast<size_t>(instr.label)) {
+                target.resize(instr.label + 1, -1);
+            }
+            target[instr.label] = static_cast<int32_t>(placed);
+        } else {
+            placed++;
+        }
+    }
+
+    std::unordered_map<int32_t, int32_t> constants;
+    bool ok = true;
+    auto cell = [&](const Operand& operand, bool written) -> int32_t {
+        size_t index = 0;
+        size_t limit = 0;
+        switch (operand.kind) {
+            case Operand::Kind::VAR:
+                index = 0;
+                limit = variables;
+                break;
+            case Operand::Kind::SPILL:
+                index = spills;
+                limit = program.spillSlots;
+                break;
+            case Operand::Kind::REG:
+                index = registers;
+                limit = program.registers;
+                break;
+            case Operand::Kind::CONST:
+                if (!written) {
+                    auto found = constants.emplace(operand.value, static_cast<int32_t>(initial.size()));
+                    if (found.second) {
+                        initial.push_back(operand.value);
+                    }
+                    return found.first->second;
+                }
+                // fall through
+            default:
+                ok = false;
+                errorMsg = "Invalid operand " + std::to_string(operand.value);
+                return 0;
+        }
+        if (operand.value < 0 || static_cast<size_t>(operand.value) >= limit) {
+            ok = false;
+            errorMsg = "Invalid operand " + std::to_string(operand.value);
+            return 0;
+        }
+        return static_cast<int32_t>(index + operand.value);
+    };
+
+    code.reserve(placed + 1);
+    for (const RegInstr& instr : program.code) {
+        Code c{nullptr, instr.op, 0, 0, 0};
+        switch (instr.op) {
+            case RegOp::LABEL:
+                continue;
+            case RegOp::JZ:
+            case RegOp::JMP:
+                if (instr.label < 0 || static_cast<size_t>(instr.label) >= target.size() || target[instr.label] < 0) {
+                    errorMsg = "Jump to undefined label L" + std::to_string(instr.label);
+                    return false;
+                }
+                c.dst = target[instr.label];
+                c.a = (instr.op == RegOp::JZ) ? cell(instr.a, false) : 0;
+                break;
+            case RegOp::MOV:
+                c.dst = cell(instr.dst, true);
+                c.a = cell(instr.a, false);
+                break;
+            default:
+                c.dst = cell(instr.dst, true);
+                c.a = cell(instr.a, false);
+                c.b = cell(instr.b, false);
+                break;
+        }
+        if (!ok) {
+            return false;
+        }
+        code.push_back(c);
+    }
+
+    // LABEL doubles as the halt instruction, since no LABEL is left
+    code.push_back(Code{nullptr, RegOp::LABEL, 0, 0, 0});
+
+    cells = initial;
+    return true;
+}
+
+
+/*
+    @brief runs the loaded program from the start with all variables 0
+    @param(s) errorMsg receives the reason on failure
+              limit stop with an error after about this many
+                    instructions, 0 for no limit
+    @return true if the program ran to completion, false otherwise
+*/
+bool RegisterVM::run(std::string& errorMsg, uint64_t limit)
+{
+#if defined(VM_THREADED)
+    static const void* const HANDLERS[] = {
+        &&do_MOV, &&do_ADD, &&do_SUB, &&do_MUL, &&do_DIV, &&do_JZ, &&do_JMP, &&do_LABEL
+    };
+    static_assert(sizeof(HANDLERS) / sizeof(HANDLERS[0]) == static_cast<size_t>(RegOp::COUNT),
+                  "every RegOp needs a handler");
+    if (!threaded) {
+        for (Code& c : code) {
+            c.handler = HANDLERS[static_cast<size_t>(c.op)];
+        }
+        threaded = true;
+    }
+#define CASE(name) do_##name:
+#define DISPATCH() do { count++; goto *ip->handler; } while (0)
+#else
+#define CASE(name) case RegOp::name:
+#define DISPATCH() do { count++; goto dispatch; } while (0)
+#endif
+
+    auto start = std::chrono::steady_clock::now();
+    std::copy(initial.begin(), initial.end(), cells.begin());
+
+    const Code* base = code.data();
+    const Code* ip = base;
+    int32_t* c = cells.data();
+    uint64_t count = 0;
+    bool ok = true;
+
+    DISPATCH();
+
+#if !defined(VM_THREADED)
+dispatch:
+    switch (ip->op) {
+#endif
+
+    CASE(MOV)
+        c[ip->dst] = c[ip->a];
+        ip++;
+        DISPATCH();
+
+    // arithmetic wraps around like two's complement 32-bit integers
+    CASE(ADD)
+        c[ip->dst] = static_cast<int32_t>(static_cast<uint32_t>(c[ip->a]) + static_cast<uint32_t>(c[ip->b]));
+        ip++;
+        DISPATCH();
+
+    CASE(SUB)
+        c[ip->dst] = static_cast<int32_t>(static_cast<uint32_t>(c[ip->a]) - static_cast<uint32_t>(c[ip->b]));
+        ip++;
+        DISPATCH();
+
+    CASE(MUL)
+        c[ip->dst] = static_cast<int32_t>(static_cast<uint32_t>(c[ip->a]) * static_cast<uint32_t>(c[ip->b]));
+        ip++;
+        DISPATCH();
+
+    CASE(DIV)
+        if (c[ip->b] == 0) {
+            errorMsg = "Division by zero at instruction " + std::to_string(ip - base);
+            ok = false;
+            goto done;
+        }
+        c[ip->dst] = (c[ip->b] == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(c[ip->a]))
+                                      : c[ip->a] / c[ip->b];
+        ip++;
+        DISPATCH();
+
+    // every loop closes with a taken jump, so both check the limit
+    CASE(JZ)
+        if (c[ip->a] != 0) {
+            ip++;
+            DISPATCH();
+        }
+        ip = base + ip->dst;
+        if (limit != 0 && count > limit) {
+            errorMsg = "Instruction limit of " + std::to_string(limit) + " exceeded";
+            ok = false;
+            goto done;
+        }
+        DISPATCH();
+
+    CASE(JMP)
+        ip = base + ip->dst;
+        if (limit != 0 && count > limit) {
+            errorMsg = "Instruction limit of " + std::to_string(limit) + " exceeded";
+            ok = false;
+            goto done;
+        }
+        DISPATCH();
+
+    // halt; no real LABEL survives load()
+    CASE(LABEL)
+        count--;
+        goto done;
+
+#if !defined(VM_THREADED)
+    default:
+        goto done;
+    }
+#endif
+
+#undef CASE
+#undef DISPATCH
+
+done:
+    stats.instructions = count;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+
+/*
+    @brief gets the value of a variable after run()
+    @param slot the variable's symbol id
+    @return its value
+*/
+int32_t RegisterVM::variable(size_t slot) const
+{
+    return cells[slot];
+}
+
+
+/*
+    @brief gets the number of variables
+    @return the variable count
+*/
+size_t RegisterVM::variableCount() const
+{
+    return variables;
+}
+
+
+/*
+    @brief gets the statistics of the last run()
+    @return the statistics
+*/
+const RegisterVM::Stats& RegisterVM::getStats() const
+{
+    return stats;
+}
+
+
+/*
+    @brief prints every variable as "name = value"
+    @param(s) program the register code the VM was loaded from
+              out the stream to print to
+    @return N/A
+*/
+void RegisterVM::printVariables(const RegisterProgram& program, std::ostream& out) const
+{
+    for (size_t i = 0; i < variables; i++) {
+        out << program.names[i] << " = " << cells[i] << "\n";
+    }
+}
+
+
+/*
+    @brief generates register code for a program, runs it, then prints
+           its variables and the execution speed
+    @param(s) program the IR to run
+              registers size of the register file
+              out stream for results
+              err stream for translation, load and runtime errors
+              limit instruction limit, 0 for none
+    @return true if the program ran to completion, false otherwise
+*/
+bool runRegisterProgram(const IRProgram& program, unsigned registers, std::ostream& out, std::ostream& err,
+                        uint64_t limit)
+{
+    RegisterProgram registerCode;
+    RegisterVM vm;
+    std::string errorMsg;
+    if (!generateRegisterCode(program, registers, registerCode, errorMsg) || !vm.load(registerCode, errorMsg)) {
+        err << "Error: " << errorMsg << std::endl;
+        return false;
+    }
+    bool ok = vm.run(errorMsg, limit);
+    if (!ok) {
+        err << "Runtime error: " << errorMsg << std::endl;
+    }
+
+    vm.printVariables(registerCode, out);
+    const RegisterVM::Stats& stats = vm.getStats();
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    out << "Register VM: " << stats.instructions << " instructions in " << stats.seconds << " s ("
+        << stats.instructions / seconds << " instructions/s)" << std::endl;
+    return ok;
+}
@@ -0,0 +1,65 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: register_vm.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the virtual machine that executes the
+ *         register backend's three-address code. Variables, spill
+ *         slots, registers and constants are all cells of one array,
+ *         so every operand is an index into it and an instruction is
+ *         one load-op-store with no stack traffic. Labels are resolved
+ *         when a program is loaded and instructions are dispatched
+ *         like the stack VM's.
+ ***************************************************************/
+
+#ifndef REGISTER_VM_H
+#define REGISTER_VM_H
+
+#include "ir.hpp"
+#include "register_code.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class RegisterVM {
+
+public:
+    // what the last run() did
+    struct Stats {
+        uint64_t instructions = 0;
+        double seconds = 0;
+    };
+
+    bool load(const RegisterProgram& program, std::string& errorMsg);
+    bool run(std::string& errorMsg, uint64_t limit = 0);
+
+    int32_t variable(size_t slot) const;
+    size_t variableCount() const;
+    const Stats& getStats() const;
+    void printVariables(const RegisterProgram& program, std::ostream& out) const;
+
+private:
+    // a loaded instruction: LABELs are gone, operands are cell
+    // indexes and a jump's dst is the instruction it goes to
+    struct Code {
+        const void* handler;
+        RegOp op;
+        int32_t dst;
+        int32_t a;
+        int32_t b;
+    };
+
+    std::vector<Code> code;
+    std::vector<int32_t> cells;         // variables, spill slots, registers, constants
+    std::vector<int32_t> initial;       // cells at the start of a run
+    size_t variables = 0;
+    bool threaded = false;
+    Stats stats;
+};
+
+bool runRegisterProgram(const IRProgram& program, unsigned registers, std::ostream& out, std::ostream& err,
+                        uint64_t limit = 0);
+
+#endif
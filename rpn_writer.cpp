@@ -0,0 +1,205 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: rpn_writer.cpp
+ *  Project 2
+ *
+ *  @brief Contains the member function definitions for the
+ *         buffered RPN output writer
+ ***************************************************************/
+
+#include "rpn_writer.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+    @brief Parameterized constructor
+    @param(s) format the output format
+              bufferSize bytes collected before each write()
+    @return N/A
+*/
+RPNWriter::RPNWriter(Format format, size_t bufferSize) : outputFormat(format), bufferSize(bufferSize)
+{
+    buffer.reserve(bufferSize + 256);
+}
+
+
+/*
+    @brief writes the RPN for a program to a file
+    @param(s) program the IR to write
+              path the output file
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool RPNWriter::write(const IRProgram& program, const std::string& path, std::string& errorMsg)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats = Stats();
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        errorMsg = "Could not write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    buffer.clear();
+    bool ok = true;
+    for (const Instr& instr : program.code) {
+        append(program, instr);
+        if (buffer.size() >= bufferSize && !flush(fd, errorMsg)) {
+            ok = false;
+            break;
+        }
+    }
+    if (ok) {
+        ok = flush(fd, errorMsg);
+    }
+    if (close(fd) != 0 && ok) {
+        errorMsg = "Could not write " + path + ": " + std::strerror(errno);
+        ok = false;
+    }
+
+    stats.instructions = program.code.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+
+/*
+    @brief formats the RPN for a program into a string
+    @param(s) program the IR to format
+              text receives the formatted RPN
+    @return N/A
+*/
+void RPNWriter::format(const IRProgram& program, std::string& text)
+{
+    buffer.swap(text);
+    buffer.clear();
+    for (const Instr& instr : program.code) {
+        append(program, instr);
+    }
+    buffer.swap(text);
+}
+
+
+/*
+    @brief gets the statistics of the last write()
+    @return the statistics
+*/
+const RPNWriter::Stats& RPNWriter::getStats() const
+{
+    return stats;
+}
+
+
+/*
+    @brief prints the size and speed of a write, as --stats shows them
+    @param(s) stats the write's statistics
+              out the stream to print to
+    @return N/A
+*/
+void RPNWriter::printStats(const Stats& stats, std::ostream& out)
+{
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    out << "RPN output: " << stats.instructions << " instructions, " << stats.bytes << " bytes in "
+        << stats.seconds << " s (" << stats.instructions / seconds << " instructions/s, "
+        << stats.bytes / seconds / (1024.0 * 1024.0) << " MB/s)" << std::endl;
+}
+
+
+/*
+    @brief formats one instruction onto the end of the buffer
+    @param(s) program the IR the instruction belongs to
+              instr the instruction
+    @return N/A
+*/
+void RPNWriter::append(const IRProgram& program, const Instr& instr)
+{
+    const char* name = OP_NAMES[static_cast<size_t>(instr.op)];
+    bool text = (outputFormat == Format::TEXT);
+
+    buffer.append(text ? "['" : "");
+    buffer.append(name);
+    if (IRProgram::hasOperand(instr.op)) {
+        buffer.append(text ? ", '" : " ");
+        switch (instr.op) {
+            case Op::PUSH:
+                appendInt(instr.arg);
+                break;
+            case Op::EVAL:
+            case Op::STORE:
+                buffer.append(program.symbolName(instr.arg));
+                break;
+            default:
+                if (!program.linked || instr.op == Op::LABEL) {
+                    buffer.push_back('L');
+                }
+                appendInt(instr.arg);
+                break;
+        }
+    }
+    buffer.append(text ? "']\n" : "\n");
+}
+
+
+/*
+    @brief formats an integer onto the end of the buffer
+    @param value the integer
+    @return N/A
+*/
+void RPNWriter::appendInt(int32_t value)
+{
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+
+/*
+    @brief hands the buffered bytes to the operating system
+    @param(s) fd the output file
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool RPNWriter::flush(int fd, std::string& errorMsg)
+{
+    size_t done = 0;
+    while (done < buffer.size()) {
+        ssize_t wrote = ::write(fd, buffer.data() + done, buffer.size() - done);
+        if (wrote < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            errorMsg = std::string("write failed: ") + std::strerror(errno);
+            return false;
+        }
+        done += static_cast<size_t>(wrote);
+    }
+    stats.bytes += buffer.size();
+    buffer.clear();
+    return true;
+}
+
+
+/*
+    @brief converts a --format option value into a format
+    @param(s) name "text" or "compact"
+              format receives the parsed format
+    @return true if the name was recognized, false otherwise
+*/
+bool RPNWriter::parseFormat(const std::string& name, Format& format)
+{
+    if (name == "text") {
+        format = Format::TEXT;
+        return true;
+    }
+    if (name == "compact") {
+        format = Format::COMPACT;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,58 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: rpn_writer.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the RPN output writer, which formats
+ *         the IR into a large reusable buffer and hands it to the
+ *         operating system in a few big write() calls.
+ *
+ *         Formats:
+ *           TEXT     ['PLUS'] / ['EVAL, 'b'], one per line (default)
+ *           COMPACT  PLUS / EVAL b, one per line
+ *
+ *         A linked program's branches are written with the target's
+ *         instruction index, ['BR, '12'] or BR 12, instead of a label.
+ ***************************************************************/
+
+#ifndef RPN_WRITER_H
+#define RPN_WRITER_H
+
+#include "ir.hpp"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+class RPNWriter {
+
+public:
+    enum class Format { TEXT, COMPACT };
+
+    // what the last write() produced
+    struct Stats {
+        size_t instructions = 0;
+        size_t bytes = 0;
+        double seconds = 0;
+    };
+
+    explicit RPNWriter(Format format = Format::TEXT, size_t bufferSize = 1 << 20);
+    bool write(const IRProgram& program, const std::string& path, std::string& errorMsg);
+    void format(const IRProgram& program, std::string& text);
+    const Stats& getStats() const;
+
+    static bool parseFormat(const std::string& name, Format& format);
+    static void printStats(const Stats& stats, std::ostream& out);
+
+private:
+    Format outputFormat;
+    std::string buffer;       // reused between writes
+    size_t bufferSize;
+    Stats stats;
+
+    void append(const IRProgram& program, const Instr& instr);
+    void appendInt(int32_t value);
+    bool flush(int fd, std::string& errorMsg);
+};
+
+#endif
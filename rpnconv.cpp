@@ -0,0 +1,54 @@
+/***************************************************************
+  Student Name: Trevor Mee
+  File Name: rpnconv.cpp
+  Project 2
+
+  @brief Converts RPN output between the text formats and the
+         binary bytecode format, in either direction. With --link
+         the program is linked on the way, so the output has
+         instruction indexes instead of labels
+***************************************************************/
+
+#include "bytecode.hpp"
+#include "linker.hpp"
+#include "rpn_writer.hpp"
+
+#include <iostream>
+
+
+int main(int argc, char* argv[]) {
+
+    bool link = argc > 1 && std::string(argv[1]) == "--link";
+    if (argc != (link ? 5 : 4)) {
+        std::cerr << "Usage: " << argv[0] << " [--link] <to-bytecode | to-text | to-compact> <input> <output>" << std::endl;
+        return 1;
+    }
+    argv += link ? 1 : 0;
+
+    std::string mode = argv[1];
+    IRProgram program;
+    std::string errorMsg;
+    LinkStats linked;
+    if (!loadRPNFile(argv[2], program, errorMsg) || (link && !linkIR(program, linked, errorMsg))) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+
+    bool ok;
+    if (mode == "to-bytecode") {
+        ok = writeBytecode(program, argv[3], errorMsg);
+    } else if (mode == "to-text" || mode == "to-compact") {
+        RPNWriter writer(mode == "to-text" ? RPNWriter::Format::TEXT : RPNWriter::Format::COMPACT);
+        ok = writer.write(program, argv[3], errorMsg);
+    } else {
+        std::cerr << "Error: Unknown conversion " << mode << std::endl;
+        return 1;
+    }
+
+    if (!ok) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return 1;
+    }
+    std::cout << program.code.size() << " instructions written to " << argv[3] << std::endl;
+    return 0;
+}
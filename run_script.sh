@@ -1,11 +1,28 @@
 #!/bin/bash
 
 # test files
-test_files=("a1.in" "a2.in" "a3.in" "a4.in" "a5.in" "a6.in" "a7.in" "a8.in")
+test_files=("a1.in" "a2.in" "a3.in" "a4.in" "a5.in" "a6.in" "a7.in" "a8.in" "a9.in" "a10.in")
 
-# Loop through the test files and run the scanner on each one
-for test_file in "${test_files[@]}"; do
-    echo "Parsing file: $test_file"
-    ./proj2 "$test_file" 
-    echo "---------------------------"
+# Compile all test files in one batch run; messages are printed per
+# file in this order, followed by a summary
+./proj2 "${test_files[@]}"
+
+# streamed through a small window, every file must give the same
+# messages, line and column included, as the in-memory compile
+for file in "${test_files[@]}"; do
+    if ! cmp -s <(./proj2 "$file" 2>&1) <(./proj2 --io=stream --chunk=16 "$file" 2>&1); then
+        echo "Error: --io=stream --chunk=16 differs from the in-memory compile for $file"
+    fi
+done
+
+# a cache hit must run the program just as a miss does: every variable,
+# unused ones included, in declaration order
+cache_dir=$(mktemp -d)
+for file in "${test_files[@]}"; do
+    miss=$(./proj2 --run --cache="$cache_dir" "$file" 2>&1 | grep -v "^Cache:\| s (")
+    hit=$(./proj2 --run --cache="$cache_dir" "$file" 2>&1 | grep -v "^Cache:\| s (")
+    if [ "$miss" != "$hit" ]; then
+        echo "Error: --run output differs between a cache miss and a hit for $file"
+    fi
 done
+rm -rf "$cache_dir"
@@ -7,9 +7,15 @@
  *         and the implementation of the scanner functions.
  ***************************************************************/
 #include "scanner.hpp"
+#include "compile_stats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
 
 // Initialize all static members
-const char Scanner::EOI = '$';
 const char Scanner::START_COMMENT = '~';
 const char Scanner::END_COMMENT = '\r';
 const char Scanner::START_STRING = '"';
@@ -19,62 +25,100 @@ const char Scanner::NOT = '!';
 const char Scanner::GREATER = '>';
 const char Scanner::LESS = '<';
 
-const std::set<char> Scanner::WHITESPACE = { ' ', '\t', '\n', '\r'};
-const std::set<char> Scanner::DIGITS = { '0','1','2','3','4','5','6','7','8','9' };
-
-// set of letters
-const std::set<char> Scanner::LETTERS = {
-    'A','B','C','D','E','F','G','H','I','J','K','L','M',
-    'N','O','P','Q','R','S','T','U','V','W','X','Y','Z',
-    'a','b','c','d','e','f','g','h','i','j','k','l','m',
-    'n','o','p','q','r','s','t','u','v','w','x','y','z'
+// table of one-character operators to their corresponding token types
+static constexpr std::array<TokenKind, 256> makeOpTable() {
+    std::array<TokenKind, 256> t{};
+    t['('] = TokenKind::lParen;
+    t[')'] = TokenKind::rParen;
+    t['{'] = TokenKind::lCurly;
+    t['}'] = TokenKind::rCurly;
+    t['+'] = TokenKind::plusSym;
+    t['-'] = TokenKind::minusSym;
+    t['*'] = TokenKind::timesSym;
+    t['/'] = TokenKind::divSym;
+    t[';'] = TokenKind::semicolon;
+    t[','] = TokenKind::comma;
+    return t;
+}
+const std::array<TokenKind, 256> Scanner::OP_TABLE = makeOpTable();
+
+// keywords and their corresponding token types
+static constexpr Scanner::Keyword KEYWORDS[] = {
+    {"while",  TokenKind::whileSym},
+    {"return", TokenKind::returnSym},
+    {"if",     TokenKind::ifSym},
+    {"else",   TokenKind::elseSym},
+    {"do",     TokenKind::doSym},
+    {"int",    TokenKind::intSym},
+    {"string", TokenKind::stringSym},
+    {"begin",  TokenKind::beginSym},
+    {"end.",   TokenKind::endSym},
+    {"var",    TokenKind::varSym}
 };
 
-// set of letters, digits, and underscore
-const std::set<char> Scanner::LETTERS_OR_DIGITS = {
-    'A','B','C','D','E','F','G','H','I','J','K','L','M',
-    'N','O','P','Q','R','S','T','U','V','W','X','Y','Z',
-    'a','b','c','d','e','f','g','h','i','j','k','l','m',
-    'n','o','p','q','r','s','t','u','v','w','x','y','z',
-    '0','1','2','3','4','5','6','7','8','9', '_', '.'
-};
+// perfect hash of the keywords: the last character plus the length
+// picks a distinct slot for each of them
+static constexpr size_t keywordHash(std::string_view word) {
+    return (static_cast<unsigned char>(word.back()) + word.size()) % Scanner::KEYWORD_TABLE_SIZE;
+}
 
-// map of operators to their corresponding token types
-const std::unordered_map<char, std::string> Scanner::OP_TABLE = {
-    {'(', "lParen"},
-    {')', "rParen"},
-    {'{', "lCurly"},
-    {'}', "rCurly"},
-    {'+', "plusSym"},
-    {'-', "minusSym"},
-    {'*', "timesSym"},
-    {'/', "divSym"},
-    {';', "semicolon"},
-    {',', "comma"}
-};
+static constexpr std::array<Scanner::Keyword, Scanner::KEYWORD_TABLE_SIZE> makeKeywordTable() {
+    std::array<Scanner::Keyword, Scanner::KEYWORD_TABLE_SIZE> t{};
+    for (const Scanner::Keyword& keyword : KEYWORDS) {
+        t[keywordHash(keyword.word)] = keyword;
+    }
+    return t;
+}
+
+static constexpr bool keywordHashIsPerfect() {
+    auto t = makeKeywordTable();
+    for (const Scanner::Keyword& keyword : KEYWORDS) {
+        if (t[keywordHash(keyword.word)].word != keyword.word) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(keywordHashIsPerfect(), "two keywords share a slot, change keywordHash");
 
-// map of keywords to their corresponding token types
-const std::unordered_map<std::string, std::string> Scanner::KEYWORD_TABLE = {
-    {"while",  "whileSym"},
-    {"return", "returnSym"},
-    {"if",     "ifSym"},
-    {"else",   "elseSym"},
-    {"do",     "doSym"},
-    {"int",    "intSym"},
-    {"string", "stringSym"},
-    {"begin",  "beginSym"},
-    {"end.",    "endSym"},
-    {"var",     "varSym"}
-};
+const std::array<Scanner::Keyword, Scanner::KEYWORD_TABLE_SIZE> Scanner::KEYWORD_TABLE = makeKeywordTable();
 
-const std::string Scanner::eoIToken = "end.";
+const TokenKind Scanner::eoIToken = TokenKind::eoi;
  
 
 /*
-    @brief parameterized constructor
+    @brief parameterized constructor, takes ownership of the source
+           and appends the EOI sentinel in place (callers that reserve
+           one spare byte avoid any reallocation)
     @param src the source code to be scanned
 */
-    Scanner::Scanner(const std::string& src) : source(src + Scanner::EOI), lineNumber(1) {
+    Scanner::Scanner(std::string src) : storage(std::move(src)), out(&std::cout) {
+        storage.push_back(Scanner::EOI);
+        source = storage;
+        init();
+    }
+
+/*
+    @brief parameterized constructor that scans a caller-owned buffer
+           in place without copying it
+    @param(s) data the source code, whose last byte must be EOI
+              size the number of bytes in data, including EOI
+*/
+    Scanner::Scanner(const char* data, size_t size) : source(data, size), out(&std::cout) {
+        init();
+    }
+
+/*
+    @brief parameterized constructor that streams the source from a
+           file descriptor through a fixed-size window, so memory
+           stays constant whatever the input size. Token text is
+           then only valid until the next call to nextToken()
+    @param(s) fd the descriptor to read from, owned by the caller
+              chunkSize how many bytes to read at a time
+*/
+    Scanner::Scanner(int fd, size_t chunkSize) : out(&std::cout), input(fd), chunkSize(chunkSize) {
+        storage.assign(2 * chunkSize + 1, Scanner::EOI);
+        source = std::string_view(storage.data(), 1);
         init();
     }
 
@@ -88,38 +132,133 @@ const std::string Scanner::eoIToken = "end.";
 */
     void Scanner::init() {
         position = 0;           
+        mark = std::string_view::npos;
         currentText = "";       
         currentToken = "";      
     }
 
 /*
-    @brief prints an error message
+    @brief prints an error message at the start of the token being
+           scanned
     @param message the error message to be printed
     @return N/A
 */
     void Scanner::error(const std::string & message) {
-        std::cout << ">>> Error at line " << getLineNumber() << ": " << message << std::endl;
+        SourceLocation at = locate(tokenStart);
+        *out << ">>> Error at line " << at.line << ":" << at.column << ": " << message << std::endl;
+    }
+
+/*
+    @brief extends the newline index up to an offset, which must be in
+           the window
+    @param offset where the index should end
+    @return N/A
+*/
+    void Scanner::indexNewlines(size_t offset) {
+        if (offset <= indexedTo) {
+            return;
+        }
+        const char* p = source.data() + (indexedTo - discarded);
+        const char* end = source.data() + (offset - discarded);
+        while ((p = static_cast<const char*>(std::memchr(p, '\n', end - p))) != nullptr) {
+            newlines.push_back(discarded + (p - source.data()));
+            p++;
+        }
+        indexedTo = offset;
     }
 
 
 /*
-    @brief returns the current character in the source code
+    @brief returns the current character in the source code. When
+           streaming, reaching the EOI sentinel at the end of the
+           window pulls in the next chunk first
     @return the current character
 */
     char Scanner::currentCh() {
-        return source[position];
+        char c = source[position];
+        if (c == Scanner::EOI && position == source.size() - 1 && refill()) {
+            c = source[position];
+        }
+        return c;
+    }
+
+/*
+    @brief slides the streaming window forward: keeps the part of the
+           token being scanned (or nothing between tokens), moves it
+           to the front and fills the rest from the input. The window
+           only grows when a single lexeme is longer than it
+    @return true if more input was read, false at end of input
+*/
+    bool Scanner::refill() {
+        if (input < 0) {
+            return false;
+        }
+        size_t limit = source.size() - 1;
+        size_t keep = (mark != std::string_view::npos) ? mark : position;
+        size_t kept = limit - keep;
+
+        // the dropped bytes can no longer be indexed, so count their lines now
+        indexNewlines(discarded + keep);
+        auto dropped = std::lower_bound(newlines.begin(), newlines.end(), discarded + keep);
+        if (dropped != newlines.begin()) {
+            discardedLines += static_cast<int>(dropped - newlines.begin());
+            discardedLineStart = *(dropped - 1) + 1;
+            newlines.erase(newlines.begin(), dropped);
+        }
+
+        std::memmove(&storage[0], &storage[keep], kept);
+        if (storage.size() - 1 - kept < chunkSize) {
+            storage.resize(kept + chunkSize + 1);
+        }
+
+        ssize_t got;
+        do {
+            got = read(input, &storage[kept], storage.size() - 1 - kept);
+        } while (got < 0 && errno == EINTR);
+        if (got < 0) {
+            error(std::string("read failed: ") + std::strerror(errno));
+            got = 0;
+        }
+
+        storage[kept + got] = Scanner::EOI;
+        source = std::string_view(storage.data(), kept + got + 1);
+        position -= keep;
+        if (mark != std::string_view::npos) {
+            mark -= keep;
+        }
+        discarded += keep;
+        if (got == 0) {
+            input = -1;
+            return false;
+        }
+        return true;
+    }
+
+/*
+    @brief offset of the current position from the start of the
+           token being scanned, which stays valid across refills
+    @return the offset
+*/
+    size_t Scanner::lexemeOffset() {
+        return position - mark;
+    }
+
+/*
+    @brief slice of the token being scanned from a lexemeOffset()
+           up to the current position
+    @param offset where the slice starts
+    @return the slice
+*/
+    std::string_view Scanner::lexemeFrom(size_t offset) {
+        return source.substr(mark + offset, position - mark - offset);
     }
 
 /*
     @brief moves the scanner to the next character in the 
-           input file & increments line number when a new 
-           line occurs
+           input file
     @return N/A
 */
     void Scanner::move() {
-        if(currentCh() == '\n'){
-            lineNumber++;
-        }
         position += 1;
     }
 
@@ -152,41 +291,41 @@ const std::string Scanner::eoIToken = "end.";
            Report error if none found before EOICollect 
            all characters found in a result string
     @param x the character to be found
-    @return the string of characters found before the character "x"
+    @return the slice of characters found before the character "x"
 */
-    std::string Scanner::find(char x) {
-        std::string result = "";
+    std::string_view Scanner::find(char x) {
+        size_t start = lexemeOffset();
         while (currentCh() != x && !atEOI()) {
-            result = result + currentCh();
             eat();
         }
         if (atEOI()) {
             error(std::string("EOI detected searching for ") + x);
-            return "";
+            return {};
         } else {
-            return result;
+            return lexemeFrom(start);
         }
     }
 
 
 /*
-    @brief Same as find but for a set "s"
-    @param s the set of characters to be found
-    @return the string of characters found before the character in the set "s"
+    @brief Same as find but for a character class "s"
+    @param s the character class bits to be found
+    @return the slice of characters found before a character in the class "s"
 */
-    std::string Scanner::findStar(const std::set<char>& s) {
-        std::string result = "";
-        while (s.find(currentCh()) == s.end() && !atEOI()) {
-            result = result + currentCh();
+    std::string_view Scanner::findStar(uint8_t s) {
+        size_t start = lexemeOffset();
+        while (!CharClass::is(currentCh(), s) && !atEOI()) {
             eat();
         }
         if (atEOI()) {
             std::string setString = "";
-            for (char ch : s) { setString.push_back(ch); }
+            for (int ch = 0; ch < 256; ch++) {
+                if (CharClass::is(static_cast<char>(ch), s)) { setString.push_back(static_cast<char>(ch)); }
+            }
             error("EOI detected searching for " + setString);
-            return "";
+            return {};
         } else {
-            return result;
+            return lexemeFrom(start);
         }
     }
 
@@ -195,58 +334,51 @@ const std::string Scanner::eoIToken = "end.";
            none other found before EOI, Collect all characters found in a 
            result string
     @param x the character to be skipped
-    @return the string of characters skipped
+    @return the slice of characters skipped
 */
-    std::string Scanner::skip(char x) {
-        std::string result = "";
+    std::string_view Scanner::skip(char x) {
+        size_t start = lexemeOffset();
         while (currentCh() == x) {
-            result = result + currentCh();
             eat();
         }
-        return result;
+        return lexemeFrom(start);
     }
 
 
 /*
-    @brief Run over characters in set "s" down the input stream, Report error if 
+    @brief Run over characters in class "s" down the input stream, Report error if 
            none other found before EOI, Collect all characters found in a result string
-    @param s the set of characters to be skipped
-    @return the string of characters skipped
+    @param s the character class bits to be skipped
+    @return the slice of characters skipped
 */
-    std::string Scanner::skipStar(const std::set<char>& s) {
-        std::string result = "";
-        while (s.find(currentCh()) != s.end()) {
-            result = result + currentCh();
+    std::string_view Scanner::skipStar(uint8_t s) {
+        size_t start = lexemeOffset();
+        while (CharClass::is(currentCh(), s)) {
             eat();
         }
-        return result;
+        return lexemeFrom(start);
     }
 
 /*
-    @brief skips over whitespaces
+    @brief skips over whitespaces, a vector register at a time where
+           available. '\r' is part of WHITESPACE, so a single run
+           covers "\r\n" line endings as well
     @return N/A
 */
     void Scanner::skipWS() {
-        skipStar(Scanner::WHITESPACE);
-    
-        while (currentCh() == '\r') { 
-            eat();  
-            if (currentCh() == '\n') { 
-                eat();
-            }
-            skipStar(Scanner::WHITESPACE);  
-        }
+        position += CharClass::whitespaceRun(source.data() + position, source.data() + source.size());
     }
 
 
   /*
-    @brief skips over comments
+    @brief skips over comments, searching for the end of the line
+           a vector register at a time where available
     @return N/A
   */
     void Scanner::skipComment() {
-        while (currentCh() != '\n' && currentCh() != Scanner::EOI) {
-            eat();
-        }
+        do {
+            position += CharClass::findLineEnd(source.data() + position, source.data() + source.size(), Scanner::EOI);
+        } while (position == source.size() - 1 && refill());
         if (currentCh() == '\n') {
             eat();
         }
@@ -258,7 +390,7 @@ const std::string Scanner::eoIToken = "end.";
     @return N/A
 */
     void Scanner::jump() {
-        if (Scanner::WHITESPACE.find(currentCh()) != Scanner::WHITESPACE.end()) {
+        if (CharClass::is(currentCh(), Scanner::WHITESPACE)) {
             skipWS();
         } else if (currentCh() == Scanner::START_COMMENT) {
             skipComment();
@@ -270,7 +402,7 @@ const std::string Scanner::eoIToken = "end.";
     @return N/A
 */
     void Scanner::jumpStar() {
-        while (Scanner::WHITESPACE.find(currentCh()) != Scanner::WHITESPACE.end() || currentCh() == Scanner::START_COMMENT) {
+        while (CharClass::is(currentCh(), Scanner::WHITESPACE) || currentCh() == Scanner::START_COMMENT) {
             jump();
         }
     }
@@ -285,51 +417,70 @@ const std::string Scanner::eoIToken = "end.";
     @return the token of type numConstant
 */
     Token Scanner::NUM() {
-        std::string numStr = skipStar(Scanner::DIGITS);
+        skipStar(Scanner::DIGITS);
         
         // ensure a number does not contain a letter
-        if (Scanner::LETTERS.find(currentCh()) != Scanner::LETTERS.end()) {
+        if (CharClass::is(currentCh(), Scanner::LETTERS)) {
             error("Invalid number format: Numbers cannot be followed by letters.");
             Token tok;
-            tok.type = "error";
+            tok.type = TokenKind::error;
             tok.value = std::monostate{};
             return tok;
         }
     
+        std::string_view numStr = lexemeFrom(0);
+        int numValue = 0;
+        auto [end, ec] = std::from_chars(numStr.data(), numStr.data() + numStr.size(), numValue);
+        (void)end;
+        if (ec == std::errc::result_out_of_range) {
+            // same report std::stoi gave for literals that do not fit an int
+            throw std::out_of_range("stoi");
+        }
+
         Token tok;
-        tok.type = "numConstant";
-        tok.value = std::stoi(numStr);
+        tok.type = TokenKind::numConstant;
+        tok.value = numValue;
         return tok;
     }
-    
 
-/* 
+
+/*
+    @brief classifies a word as a keyword with one table probe and
+           one comparison, without allocating
+    @param word the scanned word, not empty
+    @return the keyword's token type, or identifier
+*/
+    TokenKind Scanner::keywordKind(std::string_view word) {
+        const Keyword& candidate = KEYWORD_TABLE[keywordHash(word)];
+        return candidate.word == word ? candidate.kind : TokenKind::identifier;
+    }
+
+
+/*
     @brief determines if current token is an identifier
     @return the token of type identifier
 */
     Token Scanner::ID() {
-        std::string idStr;
         
         // ensure that an identifier starts with a letter
-        if (Scanner::LETTERS.find(currentCh()) == Scanner::LETTERS.end()) {
+        if (!CharClass::is(currentCh(), Scanner::LETTERS)) {
             error("Identifier must start with a letter.");
             Token tok;
-            tok.type = "error";
+            tok.type = TokenKind::error;
             tok.value = std::monostate{};
             return tok;
         }
     
-        idStr += currentCh();
         eat();
         
         // ensure that an identifier does not contain consecutive underscores
         bool lastWasUnderscore = false;
-        while (Scanner::LETTERS_OR_DIGITS.find(currentCh()) != Scanner::LETTERS_OR_DIGITS.end()) {
+        while (CharClass::is(currentCh(), Scanner::LETTERS_OR_DIGITS)) {
             if (currentCh() == '_') {
                 if (lastWasUnderscore) {
                     error("Identifier cannot have consecutive underscores.");
                     Token tok;
-                    tok.type = "error";
+                    tok.type = TokenKind::error;
                     tok.value = std::monostate{};
                     return tok;
                 }
@@ -338,28 +489,29 @@ const std::string Scanner::eoIToken = "end.";
                 lastWasUnderscore = false;
             }
     
-            idStr += currentCh();
             eat();
         }
+        std::string_view idStr = lexemeFrom(0);
         
         // ensure an identifier does not end with an underscore
         if (idStr.back() == '_') {
             error("Identifier cannot end with an underscore.");
             Token tok;
-            tok.type = "error";
+            tok.type = TokenKind::error;
             tok.value = std::monostate{};
             return tok;
         }
     
         // Check if the scanned word is a keyword
-        if (KEYWORD_TABLE.find(idStr) != KEYWORD_TABLE.end()) {
+        TokenKind keyword = keywordKind(idStr);
+        if (keyword != TokenKind::identifier) {
             Token tok;
-            tok.type = KEYWORD_TABLE.at(idStr); 
+            tok.type = keyword;
             tok.value = std::monostate{};      
             return tok;
         } else {
             Token tok;
-            tok.type = "identifier";
+            tok.type = TokenKind::identifier;
             tok.value = idStr; 
             return tok;
         }
@@ -372,11 +524,12 @@ const std::string Scanner::eoIToken = "end.";
 */
     Token Scanner::STR() {
         eat();
-        std::string chars = find(Scanner::END_STRING);
+        size_t start = lexemeOffset();
+        size_t length = find(Scanner::END_STRING).size();
         eat();
         Token tok;
-        tok.type = "stringConstant";
-        tok.value = chars;
+        tok.type = TokenKind::stringConstant;
+        tok.value = lexemeFrom(start).substr(0, length);
         return tok;
     }
 
@@ -389,7 +542,7 @@ const std::string Scanner::eoIToken = "end.";
     @return the token of type firstToken or secondToken
 
 */
-    std::string Scanner::twoCharSym(char secondCh, const std::string & firstToken, const std::string & secondToken) {
+    TokenKind Scanner::twoCharSym(char secondCh, TokenKind firstToken, TokenKind secondToken) {
         eat();
         if (currentCh() == secondCh) {
             eat();
@@ -404,8 +557,40 @@ const std::string Scanner::eoIToken = "end.";
     @return the class and lexeme of the next token
 */
     Token Scanner::nextToken() {
+        Token tok = (stats == nullptr) ? scanToken() : countedToken();
+        tok.offset = tokenStart;
+        return tok;
+    }
+
+/*
+    @brief nextToken() while stats are collected: counts the token by
+           kind and times one token in every SAMPLE_PERIOD
+    @return the class and lexeme of the next token
+*/
+    Token Scanner::countedToken() {
+        Token tok;
+        if (stats->scannedTokens++ % CompileStats::SAMPLE_PERIOD == 0) {
+            double start = CompileStats::now();
+            tok = scanToken();
+            double elapsed = CompileStats::now() - start - CompileStats::clockOverhead();
+            stats->sampledSeconds += elapsed > 0 ? elapsed : 0;
+            stats->sampledTokens++;
+        } else {
+            tok = scanToken();
+        }
+        stats->tokens[static_cast<size_t>(tok.type)]++;
+        return tok;
+    }
+
+/*
+    @brief scans the next token
+    @return the class and lexeme of the next token
+*/
+    Token Scanner::scanToken() {
+        mark = std::string_view::npos;
         
         // Trivial test of EOI (End Of Input)
+        tokenStart = discarded + position;
         if (atEOI()) {
             Token tok;
             tok.type = Scanner::eoIToken;
@@ -415,6 +600,8 @@ const std::string Scanner::eoIToken = "end.";
 
         // find token start
         jumpStar();
+        mark = position;
+        tokenStart = discarded + position;
 
         // get current character
         char c = currentCh();
@@ -422,63 +609,133 @@ const std::string Scanner::eoIToken = "end.";
         // All the possibilities (hopefully)
 
         // Arbitrary long tokens (numbers, strings, ids/reserved words)
-        if (Scanner::DIGITS.find(c) != Scanner::DIGITS.end()) {
+        if (CharClass::is(c, Scanner::DIGITS)) {
             return NUM();
         }
         if (c == Scanner::START_STRING) {
             return STR();
         }
-        if (Scanner::LETTERS.find(c) != Scanner::LETTERS.end()) {
+        if (CharClass::is(c, Scanner::LETTERS)) {
             return ID(); 
         }
 
         // Two-char tokens: ==, !=, >=, <=
         if (c == Scanner::EQUAL) {
             Token tok;
-            tok.type = twoCharSym(Scanner::EQUAL, "assignSym", "equalSym");
+            tok.type = twoCharSym(Scanner::EQUAL, TokenKind::assignSym, TokenKind::equalSym);
             tok.value = std::monostate{};
             return tok;
         }
         if (c == Scanner::NOT) {
             Token tok;
-            tok.type = twoCharSym(Scanner::EQUAL, "notSym", "notEqualSym");
+            tok.type = twoCharSym(Scanner::EQUAL, TokenKind::notSym, TokenKind::notEqualSym);
             tok.value = std::monostate{};
             return tok;
         }
         if (c == Scanner::GREATER) {
             Token tok;
-            tok.type = twoCharSym(Scanner::EQUAL, "greaterSym", "greaterEQSym");
+            tok.type = twoCharSym(Scanner::EQUAL, TokenKind::greaterSym, TokenKind::greaterEQSym);
             tok.value = std::monostate{};
             return tok;
         }
         if (c == Scanner::LESS) {
             Token tok;
-            tok.type = twoCharSym(Scanner::EQUAL, "lessSym", "lessEQSym");
+            tok.type = twoCharSym(Scanner::EQUAL, TokenKind::lessSym, TokenKind::lessEQSym);
             tok.value = std::monostate{};
             return tok;
         }
 
         // One-char tokens
-        if (Scanner::OP_TABLE.find(c) != Scanner::OP_TABLE.end()) {
+        TokenKind op = Scanner::OP_TABLE[static_cast<unsigned char>(c)];
+        if (op != TokenKind::unknown) {
             eat();
             Token tok;
-            tok.type = Scanner::OP_TABLE.at(c);
+            tok.type = op;
             tok.value = std::monostate{};
             return tok;
         }
 
         // Shrug it off, no idea!
         Token tok;
-        tok.type = "";
+        tok.type = TokenKind::unknown;
         tok.value = std::monostate{};
 
         return tok;
     }
 
     /*
-        @brief gets the current line number
+        @brief gets the line number of the current position
         @return current line number
     */
     int Scanner::getLineNumber(){
-        return lineNumber;
-    }
\ No newline at end of file
+        return locate(getOffset()).line;
+    }
+
+    /*
+        @brief works out the line and column of an offset from the
+               newline index, extending it first if needed. A streaming
+               scanner can only locate offsets still in its window, so
+               callers must locate a token before scanning past it;
+               offsets past the window are located at its end
+        @param offset a byte offset in the whole input, not discarded
+        @return its line and column
+    */
+    SourceLocation Scanner::locate(size_t offset){
+        assert(offset >= discarded && "offset was already dropped from the streaming window");
+        offset = std::min(offset, discarded + source.size() - 1);
+        indexNewlines(offset);
+        auto next = std::lower_bound(newlines.begin(), newlines.end(), offset);
+        size_t lineStart = (next == newlines.begin()) ? discardedLineStart : *(next - 1) + 1;
+        return {discardedLines + static_cast<int>(next - newlines.begin()) + 1,
+                static_cast<int>(offset - lineStart) + 1};
+    }
+
+    /*
+        @brief gets the byte offset of the current position in the
+               whole input, including bytes a streaming scanner has
+               already dropped
+        @return current byte offset
+    */
+    size_t Scanner::getOffset(){
+        return discarded + position;
+    }
+
+    /*
+        @brief gets the byte offset in the whole input at which the
+               token last returned by nextToken() starts
+        @return the token's offset
+    */
+    size_t Scanner::getTokenOffset(){
+        return tokenStart;
+    }
+
+    /*
+        @brief resumes scanning an in-memory source at a token boundary,
+               such as the start of a statement, as if everything before
+               it had been scanned. Not for streaming scanners
+        @param offset where the next token is looked for
+        @return N/A
+    */
+    void Scanner::seek(size_t offset){
+        init();
+        position = offset;
+    }
+
+    /*
+        @brief redirects diagnostics, which go to std::cout by default
+        @param stream the stream to report errors to
+        @return N/A
+    */
+    void Scanner::setOutput(std::ostream& stream){
+        out = &stream;
+    }
+
+    /*
+        @brief starts or stops collecting token counts and nextToken
+               timing samples
+        @param stats where to collect them, nullptr to stop
+        @return N/A
+    */
+    void Scanner::setStats(CompileStats* stats){
+        this->stats = stats;
+    }
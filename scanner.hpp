@@ -11,26 +11,32 @@
 #define SCANNER_H
 
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <stdexcept>
 #include <vector>
 #include <fstream>
 #include <cctype>
-#include <unordered_map>
 #include <iostream>
-#include <set>
 #include <variant>
 #include <cctype>
 #include <algorithm>
+#include <array>
+#include "charclass.hpp"
+#include "token.hpp"
 
-// structure to hold token type and token value
-struct Token {
-    std::string type;
-    std::variant<std::monostate, int, std::string> value;
+struct CompileStats;
+
+// a 1-based line and byte column in the source
+struct SourceLocation {
+    int line;
+    int column;
 };
 
 class Scanner{
 
 public:
-    static const char EOI;
+    static constexpr char EOI = '$';
     static const char START_COMMENT;
     static const char END_COMMENT;
     static const char START_STRING;
@@ -40,46 +46,85 @@ public:
     static const char GREATER;
     static const char LESS;
 
-    static const std::set<char> WHITESPACE;
-    static const std::set<char> DIGITS;
-    static const std::set<char> LETTERS;
-    static const std::set<char> LETTERS_OR_DIGITS;
+    static constexpr uint8_t WHITESPACE = CharClass::WHITESPACE;
+    static constexpr uint8_t DIGITS = CharClass::DIGIT;
+    static constexpr uint8_t LETTERS = CharClass::LETTER;
+    static constexpr uint8_t LETTERS_OR_DIGITS = CharClass::LETTER_OR_DIGIT;
 
-    static const std::unordered_map<char, std::string> OP_TABLE;
-    static const std::unordered_map<std::string, std::string> KEYWORD_TABLE;
-    static const std::string eoIToken;
+    static const std::array<TokenKind, 256> OP_TABLE;
+    // a keyword and its token type
+    struct Keyword {
+        std::string_view word;
+        TokenKind kind;
+    };
+    static constexpr size_t KEYWORD_TABLE_SIZE = 16;
+    static const std::array<Keyword, KEYWORD_TABLE_SIZE> KEYWORD_TABLE;
+    static const TokenKind eoIToken;
 
-    // Source code and scanning state
-    std::string source;
+    // Source code (always ending in EOI) and scanning state
+    std::string_view source;
     size_t position;           
     std::string currentText;   
     std::string currentToken;
-    int lineNumber;
 
     // function declarations
-    Scanner(const std::string& src);
+    explicit Scanner(std::string src);
+    Scanner(const char* data, size_t size);
+    Scanner(int fd, size_t chunkSize);
+    Scanner(const Scanner&) = delete;
+    Scanner& operator=(const Scanner&) = delete;
     void init();
     int getLineNumber();
+    SourceLocation locate(size_t offset);
+    size_t getOffset();
+    size_t getTokenOffset();
+    void seek(size_t offset);
+    void setOutput(std::ostream& stream);
+    void setStats(CompileStats* stats);
     Token nextToken();
+    static TokenKind keywordKind(std::string_view word);
     
 private:
+    std::string storage;       // owns the source when constructed from a string
+    std::ostream* out;         // where diagnostics are reported
+    int input = -1;            // descriptor being streamed, -1 once exhausted
+    size_t chunkSize = 0;      // streaming read size
+    size_t mark;               // start of the token being scanned, npos between tokens
+    size_t discarded = 0;      // bytes dropped from the front of the window
+    size_t tokenStart = 0;     // offset of the last token returned
+    CompileStats* stats = nullptr;   // token counts and timing samples, if collected
+
+    // line numbers are only worked out for diagnostics, from an index
+    // of the newlines before the furthest offset located so far. A
+    // streaming scanner folds the newlines it discards into a count
+    std::vector<size_t> newlines;    // offsets of '\n' in [discarded, indexedTo)
+    size_t indexedTo = 0;
+    int discardedLines = 0;          // newlines before the window
+    size_t discardedLineStart = 0;   // offset just past the last of them
+
     void error(const std::string& msg);
+    void indexNewlines(size_t offset);
     char currentCh();
+    bool refill();
+    size_t lexemeOffset();
+    std::string_view lexemeFrom(size_t offset);
     void move();
     bool atEOI();
     void eat();
-    std::string find(char x);
-    std::string findStar(const std::set<char>& s);
-    std::string skip(char x);
-    std::string skipStar(const std::set<char>& s);
+    std::string_view find(char x);
+    std::string_view findStar(uint8_t s);
+    std::string_view skip(char x);
+    std::string_view skipStar(uint8_t s);
     void skipWS();
     void skipComment();
     void jump();
     void jumpStar();
+    Token scanToken();
+    Token countedToken();
     Token NUM();
     Token ID();
     Token STR();
-    std::string twoCharSym(char secondCh, const std::string & firstToken, const std::string & secondToken);
+    TokenKind twoCharSym(char secondCh, TokenKind firstToken, TokenKind secondToken);
     
 };
 #endif 
@@ -0,0 +1,380 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: server.cpp
+ *  Project 2
+ *
+ *  @brief Contains the compile server's request loop, its stdin
+ *         and Unix socket front ends, and latency reporting
+ ***************************************************************/
+
+#include "server.hpp"
+#include "parser.hpp"
+#include "scanner.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+    @brief Parameterized constructor
+    @param options how every request is compiled
+    @return N/A
+*/
+CompileServer::CompileServer(const CompileOptions& options)
+    : options(options), writer(options.output.format)
+{
+}
+
+
+/*
+    @brief serves requests from standard input until QUIT, SHUTDOWN
+           or end of input, replying on standard output
+    @return 0
+*/
+int CompileServer::serveStdio()
+{
+    Connection connection(STDIN_FILENO, STDOUT_FILENO);
+    serve(connection);
+    printSummary();
+    return 0;
+}
+
+
+/*
+    @brief listens on a Unix domain socket and serves one client at a
+           time until a client sends SHUTDOWN
+    @param path the socket path; a stale socket file is replaced
+    @return 0 after SHUTDOWN, 1 if the socket could not be set up
+*/
+int CompileServer::serveSocket(const std::string& path)
+{
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << path << std::endl;
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Error: Could not create socket" << std::endl;
+        return 1;
+    }
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        std::cerr << "Error: Could not listen on " << path << std::endl;
+        close(listener);
+        return 1;
+    }
+
+    // a client that goes away mid-reply must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+    std::cerr << "Listening on " << path << std::endl;
+
+    bool running = true;
+    while (running) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error: accept failed" << std::endl;
+            break;
+        }
+        Connection connection(client, client);
+        running = serve(connection);
+        close(client);
+    }
+
+    close(listener);
+    unlink(path.c_str());
+    printSummary();
+    return 0;
+}
+
+
+/*
+    @brief answers one client's requests
+    @param connection the client
+    @return false if the client asked the server to shut down
+*/
+bool CompileServer::serve(Connection& connection)
+{
+    std::string line;
+    std::string source;
+    std::string log;
+    std::string rpn;
+
+    while (connection.readLine(line)) {
+        std::istringstream request(line);
+        std::string command;
+        request >> command;
+        if (command.empty()) {
+            continue;
+        }
+        if (command == "QUIT") {
+            return true;
+        }
+        if (command == "SHUTDOWN") {
+            return false;
+        }
+        if (command == "STATS") {
+            Summary summary = summarize();
+            std::ostringstream reply;
+            reply << "STATS " << summary.requests << " " << summary.failed << " " << summary.mean << " "
+                  << summary.p50 << " " << summary.p99 << "\n";
+            if (!connection.write(reply.str())) {
+                return true;
+            }
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = false;
+        log.clear();
+        rpn.clear();
+
+        if (command == "COMPILE") {
+            std::string path;
+            std::getline(request >> std::ws, path);
+            SourceFile file;
+            std::string errorMsg;
+            SourceFile::Mode mode = options.io == SourceFile::Mode::STREAM ? SourceFile::Mode::READ : options.io;
+            if (path.empty()) {
+                log = "Error: COMPILE expects a path\n";
+            } else if (!file.open(path, mode, errorMsg)) {
+                log = "Error: " + errorMsg + "\n";
+            } else {
+                ok = compile(file.data(), file.size(), path, log, rpn);
+            }
+        } else if (command == "SOURCE") {
+            std::string name;
+            long long size = -1;
+            request >> name >> size;
+            if (name.empty() || size < 0) {
+                log = "Error: SOURCE expects a name and a byte count\n";
+            } else if (!connection.readBytes(static_cast<size_t>(size), source)) {
+                return true;
+            } else {
+                source.push_back(Scanner::EOI);
+                ok = compile(source.data(), source.size(), name, log, rpn);
+            }
+        } else {
+            log = "Error: Unknown request " + command + "\n";
+        }
+
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        recordLatency(micros);
+        if (!ok) {
+            failures++;
+        }
+
+        std::string reply = "RESULT " + std::string(ok ? "ok " : "error ") + std::to_string(log.size()) + " "
+                          + std::to_string(rpn.size()) + " " + std::to_string(static_cast<long long>(micros)) + "\n";
+        reply += log;
+        reply += rpn;
+        if (!connection.write(reply)) {
+            return true;
+        }
+    }
+    return true;
+}
+
+
+/*
+    @brief compiles one program in memory. A fresh Scanner and Parser
+           per request means no state carries over from an earlier
+           request, whether it succeeded or not
+    @param(s) data the source, ending in the EOI sentinel
+              size its size, sentinel included
+              name the name used in messages
+              log receives every message the compile prints
+              rpn receives the RPN text if the program is legal
+    @return true if the program is legal
+*/
+bool CompileServer::compile(const char* data, size_t size, const std::string& name,
+                            std::string& log, std::string& rpn)
+{
+    std::ostringstream messages;
+    Scanner scanner(data, size);
+    scanner.setOutput(messages);
+
+    OutputOptions output = options.output;
+    output.text = false;
+    output.bytecode = false;
+    Parser parser(scanner, messages, messages);
+    parser.reserveIR(size / 4);
+    parser.setOutputOptions(output);
+
+    bool ok = parser.parse(name);
+    if (ok) {
+        writer.format(parser.getIR(), rpn);
+    }
+    log = messages.str();
+    return ok;
+}
+
+
+/*
+    @brief counts a request's latency, overwriting the oldest sample
+           once LATENCY_SAMPLES are kept
+    @param micros the request's latency in microseconds
+    @return N/A
+*/
+void CompileServer::recordLatency(double micros)
+{
+    requests++;
+    totalMicros += micros;
+    if (latencies.size() < LATENCY_SAMPLES) {
+        latencies.push_back(micros);
+    } else {
+        latencies[nextSample] = micros;
+        nextSample = (nextSample + 1) % LATENCY_SAMPLES;
+    }
+}
+
+
+/*
+    @brief summarizes the latency of the requests served so far: the
+           mean of all of them, the percentiles of the recent ones
+    @return the summary
+*/
+CompileServer::Summary CompileServer::summarize() const
+{
+    Summary summary;
+    summary.requests = requests;
+    summary.failed = failures;
+    if (latencies.empty()) {
+        return summary;
+    }
+    summary.mean = totalMicros / requests;
+
+    std::vector<double> samples(latencies);
+    auto p50 = samples.begin() + (samples.size() - 1) / 2;
+    auto p99 = samples.begin() + (samples.size() - 1) * 99 / 100;
+    std::nth_element(samples.begin(), p50, samples.end());
+    std::nth_element(p50, p99, samples.end());
+    summary.p50 = *p50;
+    summary.p99 = *p99;
+    return summary;
+}
+
+
+/*
+    @brief prints the request count and latency when the server stops
+    @return N/A
+*/
+void CompileServer::printSummary() const
+{
+    Summary summary = summarize();
+    std::cerr << "Server: " << summary.requests << " requests, " << summary.failed << " failed, latency mean "
+              << summary.mean << " us, p50 " << summary.p50 << " us, p99 " << summary.p99 << " us" << std::endl;
+}
+
+
+/*
+    @brief Parameterized constructor
+    @param(s) in descriptor requests are read from
+              out descriptor replies are written to
+    @return N/A
+*/
+CompileServer::Connection::Connection(int in, int out) : in(in), out(out)
+{
+}
+
+
+/*
+    @brief reads more input into the buffer, dropping what was consumed
+    @return false at end of input or on error
+*/
+bool CompileServer::Connection::fill()
+{
+    buffer.erase(0, position);
+    position = 0;
+    char chunk[64 * 1024];
+    ssize_t got;
+    do {
+        got = read(in, chunk, sizeof(chunk));
+    } while (got < 0 && errno == EINTR);
+    if (got <= 0) {
+        return false;
+    }
+    buffer.append(chunk, static_cast<size_t>(got));
+    return true;
+}
+
+
+/*
+    @brief reads one line, without its line ending
+    @param line receives the line
+    @return false at end of input
+*/
+bool CompileServer::Connection::readLine(std::string& line)
+{
+    size_t newline;
+    while ((newline = buffer.find('\n', position)) == std::string::npos) {
+        if (!fill()) {
+            // a last line without a line ending still counts
+            if (position < buffer.size()) {
+                line.assign(buffer, position, std::string::npos);
+                position = buffer.size();
+                return true;
+            }
+            return false;
+        }
+    }
+    line.assign(buffer, position, newline - position);
+    position = newline + 1;
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
+
+
+/*
+    @brief reads exactly count bytes
+    @param(s) count number of bytes
+              bytes receives them
+    @return false if the input ended first
+*/
+bool CompileServer::Connection::readBytes(size_t count, std::string& bytes)
+{
+    while (buffer.size() - position < count) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    bytes.assign(buffer, position, count);
+    position += count;
+    return true;
+}
+
+
+/*
+    @brief writes all of data
+    @param data the bytes to write
+    @return false if the client has gone away
+*/
+bool CompileServer::Connection::write(const std::string& data)
+{
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t wrote = ::write(out, data.data() + done, data.size() - done);
+        if (wrote < 0 && errno == EINTR) {
+            continue;
+        }
+        if (wrote <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(wrote);
+    }
+    return true;
+}
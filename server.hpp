@@ -0,0 +1,92 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: server.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the compile server: a resident compiler
+ *         that answers compile requests over stdin/stdout or a Unix
+ *         domain socket, so a build pays process startup once.
+ *
+ *         Requests, one per line:
+ *           COMPILE <path>               compile a source file
+ *           SOURCE <name> <bytes>        compile the <bytes> bytes of
+ *                                        source that follow the line
+ *           STATS                        report the latency so far
+ *           QUIT                         close this connection
+ *           SHUTDOWN                     close it and stop the server
+ *
+ *         Each COMPILE or SOURCE gets the reply
+ *           RESULT <ok|error> <log bytes> <rpn bytes> <microseconds>
+ *         followed by the log (every message a normal compile prints,
+ *         diagnostics included) and the RPN, which is empty unless
+ *         the program is legal. STATS gets
+ *           STATS <requests> <failed> <mean us> <p50 us> <p99 us>
+ *         where the mean covers every request and the percentiles the
+ *         most recent LATENCY_SAMPLES of them.
+ ***************************************************************/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "driver.hpp"
+#include "rpn_writer.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class CompileServer {
+
+public:
+    explicit CompileServer(const CompileOptions& options);
+
+    int serveStdio();
+    int serveSocket(const std::string& path);
+
+private:
+    // buffered reads from one client
+    class Connection {
+    public:
+        Connection(int in, int out);
+        bool readLine(std::string& line);
+        bool readBytes(size_t count, std::string& bytes);
+        bool write(const std::string& data);
+
+    private:
+        int in;
+        int out;
+        std::string buffer;
+        size_t position = 0;
+
+        bool fill();
+    };
+
+    // latency of the compile requests served so far
+    struct Summary {
+        size_t requests = 0;
+        size_t failed = 0;
+        double mean = 0;
+        double p50 = 0;
+        double p99 = 0;
+    };
+
+    // how many recent latencies the percentiles are taken from
+    static constexpr size_t LATENCY_SAMPLES = 4096;
+
+    CompileOptions options;
+    RPNWriter writer;                  // reused by every request
+    std::vector<double> latencies;     // ring of recent microseconds per request
+    size_t nextSample = 0;             // the ring slot written next once it is full
+    size_t requests = 0;
+    double totalMicros = 0;
+    size_t failures = 0;
+
+    bool serve(Connection& connection);
+    bool compile(const char* data, size_t size, const std::string& name,
+                 std::string& log, std::string& rpn);
+    void recordLatency(double micros);
+    Summary summarize() const;
+    void printSummary() const;
+};
+
+#endif
@@ -0,0 +1,252 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: source_file.cpp
+ *  Project 2
+ *
+ *  @brief Contains the member function definitions for loading
+ *         source files by mmap or by buffered read()
+ ***************************************************************/
+
+#include "source_file.hpp"
+#include "scanner.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+    @brief Default constructor
+    @return N/A
+*/
+SourceFile::SourceFile() : mapping(nullptr), mappingSize(0), length(0) {}
+
+
+/*
+    @brief Destructor, unmaps the input if it was mapped
+    @return N/A
+*/
+SourceFile::~SourceFile()
+{
+    release();
+}
+
+
+/*
+    @brief loads a source file, "-" meaning standard input. Pipes,
+           terminals and empty files are always read, since they
+           cannot be mapped
+    @param(s) path the file to load
+              mode the preferred way to load it
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool SourceFile::open(const std::string& path, Mode mode, std::string& errorMsg)
+{
+    release();
+
+    bool isStdin = (path == "-");
+    int fd = isStdin ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errorMsg = "Could not open file " + path;
+        return false;
+    }
+
+    struct stat info;
+    bool regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    size_t fileSize = regular ? static_cast<size_t>(info.st_size) : 0;
+
+    bool ok;
+    if (mode == Mode::STREAM) {
+        errorMsg = "Streaming inputs are read by the scanner";
+        ok = false;
+    } else if (mode == Mode::MMAP && regular && fileSize > 0) {
+        ok = mapFile(fd, fileSize, errorMsg);
+    } else {
+        ok = readFile(fd, fileSize, errorMsg);
+    }
+
+    if (!isStdin) {
+        close(fd);
+    }
+    return ok;
+}
+
+
+/*
+    @brief maps the file privately, followed by one writable byte
+           that holds the EOI sentinel. An anonymous region one byte
+           larger than the file is reserved first and the file is
+           mapped over it, so the sentinel has a page even when the
+           file size is an exact multiple of the page size
+    @param(s) fd the open file
+              fileSize size of the file in bytes
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool SourceFile::mapFile(int fd, size_t fileSize, std::string& errorMsg)
+{
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t total = (fileSize + 1 + pageSize - 1) / pageSize * pageSize;
+
+    void* base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        errorMsg = std::string("mmap failed: ") + std::strerror(errno);
+        return false;
+    }
+    void* file = mmap(base, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (file == MAP_FAILED) {
+        errorMsg = std::string("mmap failed: ") + std::strerror(errno);
+        munmap(base, total);
+        return false;
+    }
+    madvise(base, total, MADV_SEQUENTIAL);
+
+    mapping = static_cast<char*>(base);
+    mappingSize = total;
+    mapping[fileSize] = Scanner::EOI;
+    length = fileSize + 1;
+    return true;
+}
+
+
+/*
+    @brief reads the whole input with large read() calls
+    @param(s) fd the open file or pipe
+              sizeHint expected size in bytes, 0 if unknown
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool SourceFile::readFile(int fd, size_t sizeHint, std::string& errorMsg)
+{
+    const size_t CHUNK = 1 << 16;
+    buffer.resize(sizeHint + CHUNK);
+    size_t used = 0;
+
+    while (true) {
+        if (buffer.size() - used < CHUNK) {
+            buffer.resize(buffer.size() * 2);
+        }
+        ssize_t got = read(fd, &buffer[used], buffer.size() - used);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            errorMsg = std::string("read failed: ") + std::strerror(errno);
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        used += static_cast<size_t>(got);
+    }
+
+    buffer.resize(used);
+    buffer.push_back(Scanner::EOI);
+    length = buffer.size();
+    return true;
+}
+
+
+/*
+    @brief releases the mapping or buffer
+    @return N/A
+*/
+void SourceFile::release()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    buffer.clear();
+    length = 0;
+}
+
+
+/*
+    @brief gets the loaded input
+    @return pointer to the input, whose last byte is EOI
+*/
+const char* SourceFile::data() const
+{
+    return mapping != nullptr ? mapping : buffer.data();
+}
+
+
+/*
+    @brief gets the size of the loaded input
+    @return number of bytes, including the EOI sentinel
+*/
+size_t SourceFile::size() const
+{
+    return length;
+}
+
+
+/*
+    @brief checks if the input is memory-mapped
+    @return true if mapped, false if it was read
+*/
+bool SourceFile::isMapped() const
+{
+    return mapping != nullptr;
+}
+
+
+/*
+    @brief converts a --io option value into a mode
+    @param(s) name "mmap", "read" or "stream"
+              mode receives the parsed mode
+    @return true if the name was recognized, false otherwise
+*/
+bool SourceFile::parseMode(const std::string& name, Mode& mode)
+{
+    if (name == "mmap") {
+        mode = Mode::MMAP;
+        return true;
+    }
+    if (name == "read") {
+        mode = Mode::READ;
+        return true;
+    }
+    if (name == "stream") {
+        mode = Mode::STREAM;
+        return true;
+    }
+    return false;
+}
+
+
+/*
+    @brief writes data to a file, replacing its contents
+    @param(s) path the output file
+              data the bytes to write
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool writeFile(const std::string& path, std::string_view data, std::string& errorMsg)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        errorMsg = "Could not write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t wrote = ::write(fd, data.data() + done, data.size() - done);
+        if (wrote < 0 && errno == EINTR) {
+            continue;
+        }
+        if (wrote < 0) {
+            errorMsg = std::string("write failed: ") + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(wrote);
+    }
+    close(fd);
+    return true;
+}
@@ -0,0 +1,50 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: source_file.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the input layer that loads a source
+ *         file into a buffer ending in the scanner's EOI
+ *         sentinel, either by memory-mapping it or by reading it.
+ ***************************************************************/
+
+#ifndef SOURCE_FILE_H
+#define SOURCE_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+class SourceFile {
+
+public:
+    // how the input is brought into memory; STREAM inputs bypass
+    // SourceFile and are read by the scanner a window at a time
+    enum class Mode { MMAP, READ, STREAM };
+
+    SourceFile();
+    ~SourceFile();
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    bool open(const std::string& path, Mode mode, std::string& errorMsg);
+    const char* data() const;
+    size_t size() const;
+    bool isMapped() const;
+
+    static bool parseMode(const std::string& name, Mode& mode);
+
+private:
+    char* mapping;          // start of the mapped region, or nullptr
+    size_t mappingSize;     // bytes reserved for the mapping
+    std::string buffer;     // holds the input when it is read instead
+    size_t length;          // input bytes, plus the EOI sentinel
+
+    bool mapFile(int fd, size_t fileSize, std::string& errorMsg);
+    bool readFile(int fd, size_t sizeHint, std::string& errorMsg);
+    void release();
+};
+
+bool writeFile(const std::string& path, std::string_view data, std::string& errorMsg);
+
+#endif
@@ -0,0 +1,116 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: token.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the token kinds produced by the
+ *         scanner, their printable names, and the token itself.
+ ***************************************************************/
+
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <variant>
+
+// every kind of token the scanner can produce
+enum class TokenKind : uint8_t {
+    unknown,
+    error,
+    eoi,
+    identifier,
+    numConstant,
+    stringConstant,
+    lParen,
+    rParen,
+    lCurly,
+    rCurly,
+    plusSym,
+    minusSym,
+    timesSym,
+    divSym,
+    semicolon,
+    comma,
+    assignSym,
+    equalSym,
+    notSym,
+    notEqualSym,
+    greaterSym,
+    greaterEQSym,
+    lessSym,
+    lessEQSym,
+    whileSym,
+    returnSym,
+    ifSym,
+    elseSym,
+    doSym,
+    intSym,
+    stringSym,
+    beginSym,
+    endSym,
+    varSym,
+    COUNT
+};
+
+// printable token kind names, used only for diagnostics
+inline constexpr const char* TOKEN_KIND_NAMES[] = {
+    "",
+    "error",
+    "end.",
+    "identifier",
+    "numConstant",
+    "stringConstant",
+    "lParen",
+    "rParen",
+    "lCurly",
+    "rCurly",
+    "plusSym",
+    "minusSym",
+    "timesSym",
+    "divSym",
+    "semicolon",
+    "comma",
+    "assignSym",
+    "equalSym",
+    "notSym",
+    "notEqualSym",
+    "greaterSym",
+    "greaterEQSym",
+    "lessSym",
+    "lessEQSym",
+    "whileSym",
+    "returnSym",
+    "ifSym",
+    "elseSym",
+    "doSym",
+    "intSym",
+    "stringSym",
+    "beginSym",
+    "endSym",
+    "varSym"
+};
+
+static_assert(sizeof(TOKEN_KIND_NAMES) / sizeof(TOKEN_KIND_NAMES[0]) == static_cast<size_t>(TokenKind::COUNT),
+              "every TokenKind needs a name");
+
+/*
+    @brief gets the printable name of a token kind
+    @param kind the token kind
+    @return the name of the token kind
+*/
+inline const char* tokenKindName(TokenKind kind)
+{
+    return TOKEN_KIND_NAMES[static_cast<size_t>(kind)];
+}
+
+// structure to hold token type and token value; text values are
+// slices of the scanner's source buffer and live as long as it does
+struct Token {
+    TokenKind type = TokenKind::unknown;
+    std::variant<std::monostate, int, std::string_view> value;
+    size_t offset = 0;      // where it starts in the whole input, see Scanner::locate()
+};
+
+#endif
@@ -0,0 +1,390 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: token_buffer.cpp
+ *  Project 2
+ *
+ *  @brief Contains the pre-tokenization pass and the replay of the
+ *         scanner's diagnostics
+ ***************************************************************/
+
+#include "token_buffer.hpp"
+#include "scanner.hpp"
+#include "compile_stats.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+
+/*
+    @brief Default constructor
+    @return N/A
+*/
+TokenBuffer::TokenBuffer() : messageStream(&messages)
+{
+}
+
+
+/*
+    @brief appends one character to the collected diagnostics
+    @param c the character
+    @return c
+*/
+TokenBuffer::MessageSink::int_type TokenBuffer::MessageSink::overflow(int_type c)
+{
+    if (c != traits_type::eof()) {
+        text.push_back(static_cast<char>(c));
+    }
+    return c;
+}
+
+
+/*
+    @brief appends characters to the collected diagnostics
+    @param(s) s the characters
+              n how many
+    @return n
+*/
+std::streamsize TokenBuffer::MessageSink::xsputn(const char* s, std::streamsize n)
+{
+    text.append(s, static_cast<size_t>(n));
+    return n;
+}
+
+
+/*
+    @brief empties the buffer
+    @return N/A
+*/
+void TokenBuffer::clear()
+{
+    kinds.clear();
+    offsets.clear();
+    lengths.clear();
+    values.clear();
+    messages.text.clear();
+    replays.clear();
+    failure = nullptr;
+    failureIndex = SIZE_MAX;
+    end = 0;
+    finished = false;
+}
+
+
+/*
+    @brief lexes an in-memory source up to "end.", the end of input or
+           a token the Parser cannot accept. The scanner's diagnostics
+           are redirected into the buffer for replay() and it is left
+           positioned after the last token
+    @param(s) scanner a scanner at the start of an in-memory source
+              stats if set, receives the lexing time and token counts
+              threads how many threads may lex chunks of the source
+              minChunk the fewest bytes worth giving a thread
+    @return false if the source is too large for 32-bit offsets, in
+            which case nothing was scanned
+*/
+bool TokenBuffer::lex(Scanner& scanner, CompileStats* stats, unsigned threads, size_t minChunk)
+{
+    clear();
+    if (scanner.source.size() > UINT32_MAX) {
+        return false;
+    }
+    source = scanner.source.data();
+    scanner.setOutput(messageStream);
+    double start = stats != nullptr ? CompileStats::now() : 0;
+
+    size_t chunks = std::min<size_t>(threads, scanner.source.size() / std::max<size_t>(minChunk, 1));
+    if (chunks > 1) {
+        lexParallel(scanner, chunks);
+    } else {
+        // sources average a few bytes per token
+        size_t expected = scanner.source.size() / 4 + 16;
+        kinds.reserve(expected);
+        offsets.reserve(expected);
+        lengths.reserve(expected);
+        values.reserve(expected);
+        lexRange(scanner, SIZE_MAX);
+    }
+
+    if (stats != nullptr) {
+        stats->seconds[CompileStats::SCAN] += CompileStats::now() - start;
+        for (TokenKind kind : kinds) {
+            stats->tokens[static_cast<size_t>(kind)]++;
+        }
+    }
+    return true;
+}
+
+
+/*
+    @brief scans the next token into the buffer, along with what the
+           scanner printed or threw while scanning it
+    @param scanner the scanner, printing into messageStream
+    @return false once lexing must stop
+*/
+bool TokenBuffer::scanToken(Scanner& scanner)
+{
+    size_t printed = messages.text.size();
+    Token tok;
+    try {
+        tok = scanner.nextToken();
+    } catch (...) {
+        // rethrown when the Parser reaches this token
+        failure = std::current_exception();
+        failureIndex = kinds.size();
+        replays.push_back({failureIndex, messages.text.size()});
+        return false;
+    }
+    if (messages.text.size() != printed) {
+        replays.push_back({kinds.size(), messages.text.size()});
+    }
+
+    kinds.push_back(tok.type);
+    offsets.push_back(static_cast<uint32_t>(tok.offset));
+    if (std::holds_alternative<std::string_view>(tok.value)) {
+        lengths.push_back(static_cast<uint32_t>(std::get<std::string_view>(tok.value).size()));
+        values.push_back(0);
+    } else {
+        lengths.push_back(0);
+        values.push_back(std::holds_alternative<int>(tok.value) ? std::get<int>(tok.value) : 0);
+    }
+    // the Parser reads no further than "end.", or than a token no
+    // grammar rule accepts (an unknown one does not even advance)
+    return tok.type != TokenKind::endSym && tok.type != TokenKind::eoi
+        && tok.type != TokenKind::unknown && tok.type != TokenKind::error;
+}
+
+
+/*
+    @brief lexes until lexing must stop or the next token starts at or
+           after a limit; that token is dropped again, with anything
+           printed while scanning it
+    @param(s) scanner the scanner, printing into messageStream
+              limit the first offset whose tokens belong to someone else
+    @return N/A
+*/
+void TokenBuffer::lexRange(Scanner& scanner, size_t limit)
+{
+    end = scanner.getOffset();
+    while (true) {
+        size_t count = kinds.size();
+        size_t printed = messages.text.size();
+        size_t replayed = replays.size();
+        bool more = scanToken(scanner);
+        if (kinds.size() > count && offsets.back() >= limit) {
+            kinds.resize(count);
+            offsets.resize(count);
+            lengths.resize(count);
+            values.resize(count);
+            messages.text.resize(printed);
+            replays.resize(replayed);
+            return;
+        }
+        end = scanner.getOffset();
+        if (!more) {
+            finished = true;
+            return;
+        }
+    }
+}
+
+
+/*
+    @brief lexes chunks of the source on separate threads and joins
+           them into exactly the tokens a serial lex finds
+    @param(s) scanner a scanner at the start of the source, printing
+                      into messageStream; it lexes the first chunk
+              chunks how many chunks to aim for
+    @return N/A
+*/
+void TokenBuffer::lexParallel(Scanner& scanner, size_t chunks)
+{
+    const char* data = scanner.source.data();
+    size_t size = scanner.source.size();
+
+    // every chunk but the first starts just after a newline
+    std::vector<size_t> starts = {0};
+    for (size_t c = 1; c < chunks; c++) {
+        size_t at = size / chunks * c;
+        const void* newline = std::memchr(data + at, '\n', size - at);
+        if (newline == nullptr) {
+            break;
+        }
+        at = static_cast<size_t>(static_cast<const char*>(newline) - data) + 1;
+        if (at > starts.back() && at < size) {
+            starts.push_back(at);
+        }
+    }
+    starts.push_back(SIZE_MAX);
+    size_t count = starts.size() - 1;
+
+    // chunk 0 is lexed straight into this buffer
+    std::deque<TokenBuffer> pieces(count - 1);
+    std::vector<std::thread> workers;
+    for (size_t c = 1; c < count; c++) {
+        workers.emplace_back([&, c]() {
+            TokenBuffer& piece = pieces[c - 1];
+            Scanner pieceScanner(data, size);
+            pieceScanner.seek(starts[c]);
+            pieceScanner.setOutput(piece.messageStream);
+            piece.source = data;
+            size_t expected = (std::min(starts[c + 1], size) - starts[c]) / 4 + 16;
+            piece.kinds.reserve(expected);
+            piece.offsets.reserve(expected);
+            piece.lengths.reserve(expected);
+            piece.values.reserve(expected);
+            piece.lexRange(pieceScanner, starts[c + 1]);
+        });
+    }
+    size_t expected = size / 4 + 16;
+    kinds.reserve(expected);
+    offsets.reserve(expected);
+    lengths.reserve(expected);
+    values.reserve(expected);
+    lexRange(scanner, starts[1]);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    size_t next = 1;
+    while (!finished && next < count) {
+        // scan on from the last token until one starts where a token
+        // of the chunk it falls in starts
+        scanner.seek(end);
+        while (true) {
+            size_t tokenCount = kinds.size();
+            size_t printed = messages.text.size();
+            size_t replayed = replays.size();
+            bool more = scanToken(scanner);
+            end = scanner.getOffset();
+            if (!more) {
+                finished = true;
+                break;
+            }
+            size_t start = offsets.back();
+            while (start >= starts[next + 1]) {
+                next++;
+            }
+            const TokenBuffer& piece = pieces[next - 1];
+            auto found = std::lower_bound(piece.offsets.begin(), piece.offsets.end(), start);
+            if (found != piece.offsets.end() && *found == start) {
+                kinds.resize(tokenCount);
+                offsets.resize(tokenCount);
+                lengths.resize(tokenCount);
+                values.resize(tokenCount);
+                messages.text.resize(printed);
+                replays.resize(replayed);
+                append(piece, static_cast<size_t>(found - piece.offsets.begin()));
+                next++;
+                break;
+            }
+        }
+    }
+    // only reached if the last chunk stopped short, which it cannot
+    if (!finished) {
+        scanner.seek(end);
+        lexRange(scanner, SIZE_MAX);
+    }
+    scanner.seek(end);
+}
+
+
+/*
+    @brief appends the tail of a chunk's tokens, with their diagnostics
+           and failure, and takes over where the chunk stopped
+    @param(s) chunk the chunk
+              first its first token to take
+    @return N/A
+*/
+void TokenBuffer::append(const TokenBuffer& chunk, size_t first)
+{
+    size_t base = kinds.size();
+    kinds.insert(kinds.end(), chunk.kinds.begin() + first, chunk.kinds.end());
+    offsets.insert(offsets.end(), chunk.offsets.begin() + first, chunk.offsets.end());
+    lengths.insert(lengths.end(), chunk.lengths.begin() + first, chunk.lengths.end());
+    values.insert(values.end(), chunk.values.begin() + first, chunk.values.end());
+
+    auto from = std::lower_bound(chunk.replays.begin(), chunk.replays.end(), first,
+                                 [](const Replay& replay, size_t at) { return replay.index < at; });
+    size_t textBegin = (from == chunk.replays.begin()) ? 0 : (from - 1)->end;
+    size_t textBase = messages.text.size();
+    messages.text.append(chunk.messages.text, textBegin, std::string::npos);
+    for (auto replay = from; replay != chunk.replays.end(); ++replay) {
+        replays.push_back({replay->index - first + base, replay->end - textBegin + textBase});
+    }
+    if (chunk.failureIndex != SIZE_MAX) {
+        failure = chunk.failure;
+        failureIndex = chunk.failureIndex - first + base;
+    }
+    end = chunk.end;
+    finished = chunk.finished;
+}
+
+
+/*
+    @brief compares two buffers token for token, including diagnostics,
+           where lexing stopped and whether it failed
+    @param other the other buffer
+    @return true if the Parser would see no difference
+*/
+bool TokenBuffer::matches(const TokenBuffer& other) const
+{
+    if (replays.size() != other.replays.size()) {
+        return false;
+    }
+    for (size_t r = 0; r < replays.size(); r++) {
+        if (replays[r].index != other.replays[r].index || replays[r].end != other.replays[r].end) {
+            return false;
+        }
+    }
+    return kinds == other.kinds && offsets == other.offsets && lengths == other.lengths
+        && values == other.values && messages.text == other.messages.text
+        && failureIndex == other.failureIndex && end == other.end && finished == other.finished;
+}
+
+
+/*
+    @brief gets the number of tokens lexed
+    @return the token count
+*/
+size_t TokenBuffer::size() const
+{
+    return kinds.size();
+}
+
+
+/*
+    @brief gets the first token with something to replay
+    @param from the first token to consider
+    @return its index, SIZE_MAX if there is none
+*/
+size_t TokenBuffer::firstReplay(size_t from) const
+{
+    auto found = std::lower_bound(replays.begin(), replays.end(), from,
+                                  [](const Replay& replay, size_t at) { return replay.index < at; });
+    return found == replays.end() ? SIZE_MAX : found->index;
+}
+
+
+/*
+    @brief prints the diagnostics the scanner printed while scanning a
+           token, and rethrows what it threw, if anything
+    @param(s) index a token returned by firstReplay() or replay()
+              out where the diagnostics go
+    @return the next token with something to replay, SIZE_MAX if none
+*/
+size_t TokenBuffer::replay(size_t index, std::ostream& out) const
+{
+    auto found = std::lower_bound(replays.begin(), replays.end(), index,
+                                  [](const Replay& replay, size_t at) { return replay.index < at; });
+    if (found == replays.end() || found->index != index) {
+        return found == replays.end() ? SIZE_MAX : found->index;
+    }
+    size_t begin = (found == replays.begin()) ? 0 : (found - 1)->end;
+    out.write(messages.text.data() + begin, static_cast<std::streamsize>(found->end - begin));
+    if (index == failureIndex) {
+        std::rethrow_exception(failure);
+    }
+    return (found + 1 == replays.end()) ? SIZE_MAX : (found + 1)->index;
+}
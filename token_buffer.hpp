@@ -0,0 +1,139 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: token_buffer.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the token buffer used by --pretokenize.
+ *         The whole input is lexed in one tight loop before parsing
+ *         starts, into struct-of-arrays buffers: kinds, start offsets,
+ *         lengths and integer values. The Parser then walks them by
+ *         index instead of calling Scanner::nextToken() per token.
+ *
+ *         Lexing stops where the Parser must stop: at "end." or at a
+ *         token no grammar rule accepts, so no extra source is
+ *         scanned. The scanner's diagnostics, and anything it throws,
+ *         are kept with the token being scanned and are replayed when
+ *         the Parser reaches that token, so the output is the same as
+ *         when scanning and parsing are interleaved.
+ *
+ *         A large source can be lexed on several threads. It is cut
+ *         into chunks at line starts, and each chunk is lexed on its
+ *         own from its first byte. A comment never runs past a newline,
+ *         so no chunk starts inside one, but a chunk may start inside a
+ *         string. Chunks are then joined in order: the scan goes on
+ *         serially from the end of the previous chunk until it finds a
+ *         token starting where one of the chunk's tokens starts. The
+ *         scanner keeps no state between tokens, so from there on the
+ *         chunk's tokens and diagnostics are what the serial scan
+ *         would produce, and the result always matches lex() with one
+ *         thread. A chunk that never resynchronizes is simply lexed
+ *         again serially.
+ ***************************************************************/
+
+#ifndef TOKEN_BUFFER_H
+#define TOKEN_BUFFER_H
+
+#include "token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+class Scanner;
+struct CompileStats;
+
+class TokenBuffer {
+
+public:
+    // below this many bytes per chunk another thread does not pay off
+    static constexpr size_t MIN_CHUNK = 256 * 1024;
+
+    TokenBuffer();
+    TokenBuffer(const TokenBuffer&) = delete;
+    TokenBuffer& operator=(const TokenBuffer&) = delete;
+
+    bool lex(Scanner& scanner, CompileStats* stats = nullptr, unsigned threads = 1, size_t minChunk = MIN_CHUNK);
+    bool matches(const TokenBuffer& other) const;
+    size_t size() const;
+    size_t firstReplay(size_t from = 0) const;
+    size_t replay(size_t index, std::ostream& out) const;
+
+    /*
+        @brief gets a token's kind without building the token, for
+               looking any distance ahead
+        @param index the token's index, clamped to the last token
+        @return its kind
+    */
+    TokenKind kind(size_t index) const {
+        return kinds[index < kinds.size() ? index : kinds.size() - 1];
+    }
+
+    /*
+        @brief fills in a token as the scanner returned it, in place so
+               only the parts that change are written. Text values are
+               slices of the source, as they are from the scanner
+        @param(s) index the token's index, clamped to the last token
+                  tok receives the token
+        @return N/A
+    */
+    void load(size_t index, Token& tok) const {
+        if (index >= kinds.size()) {
+            index = kinds.size() - 1;
+        }
+        tok.type = kinds[index];
+        tok.offset = offsets[index];
+        switch (tok.type) {
+            case TokenKind::numConstant:
+                tok.value.emplace<int>(values[index]);
+                break;
+            case TokenKind::identifier:
+                tok.value.emplace<std::string_view>(source + offsets[index], lengths[index]);
+                break;
+            case TokenKind::stringConstant:
+                tok.value.emplace<std::string_view>(source + offsets[index] + 1, lengths[index]);   // after the quote
+                break;
+            default:
+                tok.value.emplace<std::monostate>();
+                break;
+        }
+    }
+
+private:
+    // collects the scanner's diagnostics without a virtual call per token
+    struct MessageSink : std::streambuf {
+        std::string text;
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char* s, std::streamsize n) override;
+    };
+
+    // the diagnostics printed while scanning one token
+    struct Replay {
+        size_t index;                 // the token
+        size_t end;                   // end of its messages in messages.text
+    };
+
+    const char* source = nullptr;     // the scanner's in-memory source
+    std::vector<TokenKind> kinds;
+    std::vector<uint32_t> offsets;    // where each token starts
+    std::vector<uint32_t> lengths;    // length of an identifier or string value
+    std::vector<int32_t> values;      // value of a number
+    MessageSink messages;
+    std::ostream messageStream;
+    std::vector<Replay> replays;      // in token order
+    std::exception_ptr failure;       // thrown while scanning token failureIndex
+    size_t failureIndex = SIZE_MAX;
+    size_t end = 0;                   // where the scanner stopped, after the last token
+    bool finished = false;            // stopped where the Parser must stop
+
+    void clear();
+    bool scanToken(Scanner& scanner);
+    void lexRange(Scanner& scanner, size_t limit);
+    void lexParallel(Scanner& scanner, size_t chunks);
+    void append(const TokenBuffer& chunk, size_t first);
+};
+
+#endif
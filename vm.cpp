@@ -0,0 +1,373 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: vm.cpp
+ *  Project 2
+ *
+ *  @brief Contains the member function definitions for loading,
+ *         verifying and executing RPN programs
+ ***************************************************************/
+
+#include "vm.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED 1
+#endif
+
+/*
+    @brief loads a program: strips the LABEL pseudo-instructions,
+           turns branch operands into instruction indexes, appends
+           a halt and verifies the stack discipline. A linked program
+           already has instruction indexes and is only checked
+    @param(s) program the IR to load
+              errorMsg receives the reason on failure
+    @return true on success, false otherwise
+*/
+bool VM::load(const IRProgram& program, std::string& errorMsg)
+{
+    code.clear();
+    threaded = false;
+
+    // where each label lands once LABELs are removed
+    std::vector<int32_t> target;
+    size_t placed = 0;
+    for (const Instr& instr : program.code) {
+        if (instr.op == Op::LABEL && program.linked) {
+            errorMsg = "Label L" + std::to_string(instr.arg) + " in a linked program";
+            return false;
+        }
+        if (instr.op == Op::LABEL) {
+            if (instr.arg < 0) {
+                errorMsg = "Invalid label L" + std::to_string(instr.arg);
+                return false;
+            }
+            if (target.size() <= static_cast<size_t>(instr.arg)) {
+                target.resize(instr.arg + 1, -1);
+            }
+            target[instr.arg] = static_cast<int32_t>(placed);
+        } else {
+            placed++;
+        }
+    }
+
+    code.reserve(placed + 1);
+    for (const Instr& instr : program.code) {
+        if (instr.op == Op::LABEL) {
+            continue;
+        }
+        Code c{nullptr, instr.op, instr.arg};
+        if ((instr.op == Op::BZ || instr.op == Op::BR) && program.linked) {
+            if (instr.arg < 0 || static_cast<size_t>(instr.arg) > placed) {
+                errorMsg = "Branch to invalid instruction " + std::to_string(instr.arg);
+                return false;
+            }
+        } else if (instr.op == Op::BZ || instr.op == Op::BR) {
+            if (instr.arg < 0 || static_cast<size_t>(instr.arg) >= target.size() || target[instr.arg] < 0) {
+                errorMsg = "Branch to undefined label L" + std::to_string(instr.arg);
+                return false;
+            }
+            c.arg = target[instr.arg];
+        } else if (instr.op == Op::EVAL || instr.op == Op::STORE) {
+            if (instr.arg < 0 || static_cast<size_t>(instr.arg) >= program.symbolCount()) {
+                errorMsg = "Invalid symbol id " + std::to_string(instr.arg);
+                return false;
+            }
+        }
+        code.push_back(c);
+    }
+
+    // LABEL doubles as the halt instruction, since no LABEL is left
+    code.push_back(Code{nullptr, Op::LABEL, 0});
+
+    variables.assign(program.symbolCount(), 0);
+    return verify(errorMsg);
+}
+
+
+/*
+    @brief checks that every instruction sees the same stack depth on
+           every path and never pops an empty stack, so run() needs no
+           stack checks; also finds the deepest stack needed
+    @param errorMsg receives the reason on failure
+    @return true if the program is well formed, false otherwise
+*/
+bool VM::verify(std::string& errorMsg)
+{
+    std::vector<int32_t> depth(code.size(), -1);
+    std::vector<size_t> work;
+    depth[0] = 0;
+    work.push_back(0);
+    maxDepth = 0;
+
+    auto reach = [&](size_t at, int32_t d) {
+        if (depth[at] < 0) {
+            depth[at] = d;
+            work.push_back(at);
+            return true;
+        }
+        return depth[at] == d;
+    };
+
+    while (!work.empty()) {
+        size_t i = work.back();
+        work.pop_back();
+        int32_t d = depth[i];
+        int32_t pops = 0;
+        int32_t pushes = 0;
+        switch (code[i].op) {
+            case Op::PUSH:
+            case Op::EVAL:
+                pushes = 1;
+                break;
+            case Op::STORE:
+            case Op::BZ:
+                pops = 1;
+                break;
+            case Op::PLUS:
+            case Op::MINUS:
+            case Op::TIMES:
+            case Op::DIV:
+                pops = 2;
+                pushes = 1;
+                break;
+            default:
+                break;
+        }
+        if (d < pops) {
+            errorMsg = "Stack underflow at instruction " + std::to_string(i);
+            return false;
+        }
+        int32_t after = d - pops + pushes;
+        maxDepth = std::max(maxDepth, static_cast<size_t>(after));
+
+        bool ok = true;
+        if (code[i].op == Op::BR) {
+            ok = reach(code[i].arg, after);
+        } else if (code[i].op == Op::BZ) {
+            ok = reach(code[i].arg, after) && reach(i + 1, after);
+        } else if (code[i].op != Op::LABEL) {
+            ok = reach(i + 1, after);
+        }
+        if (!ok) {
+            errorMsg = "Inconsistent stack depth at instruction " + std::to_string(i);
+            return false;
+        }
+    }
+
+    stack.assign(maxDepth + 1, 0);
+    return true;
+}
+
+
+/*
+    @brief runs the loaded program from the start with all variables 0
+    @param(s) errorMsg receives the reason on failure
+              limit stop with an error after about this many
+                    instructions, 0 for no limit
+    @return true if the program ran to completion, false otherwise
+*/
+bool VM::run(std::string& errorMsg, uint64_t limit)
+{
+#if defined(VM_THREADED)
+    static const void* const HANDLERS[] = {
+        &&do_PUSH, &&do_EVAL, &&do_STORE, &&do_PLUS, &&do_MINUS,
+        &&do_TIMES, &&do_DIV, &&do_BZ, &&do_BR, &&do_LABEL
+    };
+    static_assert(sizeof(HANDLERS) / sizeof(HANDLERS[0]) == static_cast<size_t>(Op::COUNT),
+                  "every Op needs a handler");
+    if (!threaded) {
+        for (Code& c : code) {
+            c.handler = HANDLERS[static_cast<size_t>(c.op)];
+        }
+        threaded = true;
+    }
+#define CASE(name) do_##name:
+#define DISPATCH() do { count++; goto *ip->handler; } while (0)
+#else
+#define CASE(name) case Op::name:
+#define DISPATCH() do { count++; goto dispatch; } while (0)
+#endif
+
+    auto start = std::chrono::steady_clock::now();
+    std::fill(variables.begin(), variables.end(), 0);
+
+    const Code* base = code.data();
+    const Code* ip = base;
+    int32_t* sp = stack.data();
+    int32_t* vars = variables.data();
+    uint64_t count = 0;
+    bool ok = true;
+
+    DISPATCH();
+
+#if !defined(VM_THREADED)
+dispatch:
+    switch (ip->op) {
+#endif
+
+    CASE(PUSH)
+        *sp++ = ip->arg;
+        ip++;
+        DISPATCH();
+
+    CASE(EVAL)
+        *sp++ = vars[ip->arg];
+        ip++;
+        DISPATCH();
+
+    CASE(STORE)
+        vars[ip->arg] = *--sp;
+        ip++;
+        DISPATCH();
+
+    // arithmetic wraps around like two's complement 32-bit integers
+    CASE(PLUS)
+        sp--;
+        sp[-1] = static_cast<int32_t>(static_cast<uint32_t>(sp[-1]) + static_cast<uint32_t>(sp[0]));
+        ip++;
+        DISPATCH();
+
+    CASE(MINUS)
+        sp--;
+        sp[-1] = static_cast<int32_t>(static_cast<uint32_t>(sp[-1]) - static_cast<uint32_t>(sp[0]));
+        ip++;
+        DISPATCH();
+
+    CASE(TIMES)
+        sp--;
+        sp[-1] = static_cast<int32_t>(static_cast<uint32_t>(sp[-1]) * static_cast<uint32_t>(sp[0]));
+        ip++;
+        DISPATCH();
+
+    CASE(DIV)
+        sp--;
+        if (sp[0] == 0) {
+            errorMsg = "Division by zero at instruction " + std::to_string(ip - base);
+            ok = false;
+            goto done;
+        }
+        sp[-1] = (sp[0] == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(sp[-1])) : sp[-1] / sp[0];
+        ip++;
+        DISPATCH();
+
+    // every loop closes with a taken branch, and once jumps are
+    // threaded that may be a BZ, so both check the limit
+    CASE(BZ)
+        if (*--sp != 0) {
+            ip++;
+            DISPATCH();
+        }
+        ip = base + ip->arg;
+        if (limit != 0 && count > limit) {
+            errorMsg = "Instruction limit of " + std::to_string(limit) + " exceeded";
+            ok = false;
+            goto done;
+        }
+        DISPATCH();
+
+    CASE(BR)
+        ip = base + ip->arg;
+        if (limit != 0 && count > limit) {
+            errorMsg = "Instruction limit of " + std::to_string(limit) + " exceeded";
+            ok = false;
+            goto done;
+        }
+        DISPATCH();
+
+    // halt; no real LABEL survives load()
+    CASE(LABEL)
+        count--;
+        goto done;
+
+#if !defined(VM_THREADED)
+    default:
+        goto done;
+    }
+#endif
+
+#undef CASE
+#undef DISPATCH
+
+done:
+    stats.instructions = count;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+
+/*
+    @brief gets the value of a variable after run()
+    @param slot the variable's symbol id
+    @return its value
+*/
+int32_t VM::variable(size_t slot) const
+{
+    return variables[slot];
+}
+
+
+/*
+    @brief gets the number of variables
+    @return the variable count
+*/
+size_t VM::variableCount() const
+{
+    return variables.size();
+}
+
+
+/*
+    @brief gets the statistics of the last run()
+    @return the statistics
+*/
+const VM::Stats& VM::getStats() const
+{
+    return stats;
+}
+
+
+/*
+    @brief prints every variable as "name = value"
+    @param(s) program the IR the VM was loaded from
+              out the stream to print to
+    @return N/A
+*/
+void VM::printVariables(const IRProgram& program, std::ostream& out) const
+{
+    for (size_t i = 0; i < variables.size(); i++) {
+        out << program.symbolName(static_cast<int32_t>(i)) << " = " << variables[i] << "\n";
+    }
+}
+
+
+/*
+    @brief loads and runs a program, then prints its variables and
+           the execution speed
+    @param(s) program the IR to run
+              out stream for results
+              err stream for load and runtime errors
+              limit instruction limit, 0 for none
+    @return true if the program ran to completion, false otherwise
+*/
+bool runProgram(const IRProgram& program, std::ostream& out, std::ostream& err, uint64_t limit)
+{
+    VM vm;
+    std::string errorMsg;
+    if (!vm.load(program, errorMsg)) {
+        err << "Error: " << errorMsg << std::endl;
+        return false;
+    }
+    bool ok = vm.run(errorMsg, limit);
+    if (!ok) {
+        err << "Runtime error: " << errorMsg << std::endl;
+    }
+
+    vm.printVariables(program, out);
+    const VM::Stats& stats = vm.getStats();
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    out << "VM: " << stats.instructions << " instructions in " << stats.seconds << " s ("
+        << stats.instructions / seconds << " instructions/s)" << std::endl;
+    return ok;
+}
@@ -0,0 +1,61 @@
+/***************************************************************
+ *  Student Name: Trevor Mee
+ *  File Name: vm.hpp
+ *  Project 2
+ *
+ *  @brief This file defines the virtual machine that executes the
+ *         RPN stream. Labels are resolved once when a program is
+ *         loaded, variables live in a flat array indexed by symbol
+ *         id, and instructions are dispatched with direct threading
+ *         (computed goto) where the compiler supports it.
+ ***************************************************************/
+
+#ifndef VM_H
+#define VM_H
+
+#include "ir.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class VM {
+
+public:
+    // what the last run() did
+    struct Stats {
+        uint64_t instructions = 0;
+        double seconds = 0;
+    };
+
+    bool load(const IRProgram& program, std::string& errorMsg);
+    bool run(std::string& errorMsg, uint64_t limit = 0);
+
+    int32_t variable(size_t slot) const;
+    size_t variableCount() const;
+    const Stats& getStats() const;
+    void printVariables(const IRProgram& program, std::ostream& out) const;
+
+private:
+    // a loaded instruction: LABELs are gone and branch operands are
+    // instruction indexes
+    struct Code {
+        const void* handler;
+        Op op;
+        int32_t arg;
+    };
+
+    std::vector<Code> code;
+    std::vector<int32_t> variables;
+    std::vector<int32_t> stack;
+    size_t maxDepth = 0;
+    bool threaded = false;
+    Stats stats;
+
+    bool verify(std::string& errorMsg);
+};
+
+bool runProgram(const IRProgram& program, std::ostream& out, std::ostream& err, uint64_t limit = 0);
+
+#endif